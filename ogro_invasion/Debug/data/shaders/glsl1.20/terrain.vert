@@ -19,23 +19,41 @@ struct light {
 
 uniform light light0;
 
+//Undo the quantization of the terrain's vertices
+uniform vec3 position_scale;
+uniform vec3 position_offset;
+uniform float texcoord_scale;
+
 in vec3 a_Vertex;
 in vec2 a_TexCoord0;
 in float a_TexCoord1;
-in vec3 a_Normal;
+in vec2 a_Normal; //Octahedral encoded
 
 out vec4 color;
 out vec2 texCoord0;
 out float texCoord1;
 
+//Undoes the octahedral encoding done by the terrain
+vec3 decodeNormal(vec2 encoded)
+{
+	vec3 n = vec3(encoded.x, 1.0 - abs(encoded.x) - abs(encoded.y), encoded.y);
+	if (n.y < 0.0)
+	{
+		n.x = (1.0 - abs(encoded.y)) * (encoded.x >= 0.0 ? 1.0 : -1.0);
+		n.z = (1.0 - abs(encoded.x)) * (encoded.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
 void main(void) 
 {
-	vec3 N = normalize(normal_matrix * a_Normal);	
+	vec3 position = a_Vertex * position_scale + position_offset;
+	vec3 N = normalize(normal_matrix * decodeNormal(a_Normal));	
 	vec3 L = normalize(modelview_matrix * light0.position).xyz;
 	float NdotL = max(dot(N, L.xyz), 0.0);
 
 	vec4 finalColor = material_ambient * light0.ambient;
-	vec4 pos = modelview_matrix * vec4(a_Vertex, 1.0);	
+	vec4 pos = modelview_matrix * vec4(position, 1.0);	
 	vec3 E = -pos.xyz;
 
 	if (NdotL > 0.0) 
@@ -49,7 +67,7 @@ void main(void)
 
 	color = finalColor;
 	
-	texCoord0 = a_TexCoord0;
+	texCoord0 = a_TexCoord0 * texcoord_scale;
 	texCoord1 = a_TexCoord1;
 
 	gl_Position = projection_matrix * pos;	
@@ -0,0 +1,36 @@
+#version 150
+
+uniform mat4 projection_matrix;
+uniform mat4 modelview_matrix;
+
+uniform sampler2D keyframes;
+uniform int vertex_count;
+uniform int keyframe_width;
+
+in vec2 a_TexCoord0;
+in vec4 a_Transform; //xyz is the position, w is the yaw in degrees
+in vec3 a_Frames; //The current frame, the next frame and the blend between them
+
+out vec2 texCoord0;
+
+vec3 fetchVertex(float frame)
+{
+	int index = int(frame) * vertex_count + gl_VertexID;
+	return texelFetch(keyframes, ivec2(index % keyframe_width, index / keyframe_width), 0).xyz;
+}
+
+void main(void) 
+{
+	//Blend between the current and next key frames
+	vec3 vertex = mix(fetchVertex(a_Frames.x), fetchVertex(a_Frames.y), a_Frames.z);
+
+	//Rotate around the negative Y axis by the yaw, then move into place
+	float yaw = radians(a_Transform.w);
+	float c = cos(yaw);
+	float s = sin(yaw);
+	vec3 world = vec3(c * vertex.x - s * vertex.z, vertex.y, s * vertex.x + c * vertex.z) + a_Transform.xyz;
+
+	vec4 pos = modelview_matrix * vec4(world, 1.0);
+	texCoord0 = a_TexCoord0;
+	gl_Position = projection_matrix * pos;	
+}
@@ -0,0 +1,102 @@
+#version 150
+
+uniform mat4 projection_matrix;
+uniform mat4 modelview_matrix;
+uniform mat3 normal_matrix;
+
+uniform vec4 material_ambient;
+uniform vec4 material_diffuse;
+uniform vec4 material_specular;
+uniform vec4 material_emissive;
+uniform float material_shininess;
+
+struct light {
+	vec4 position;
+	vec4 diffuse;
+	vec4 specular;
+	vec4 ambient;
+};
+
+uniform light light0;
+
+//The terrain's heights, one texel per grid position
+uniform sampler2D heightfield;
+uniform int grid_width;
+
+//Where the patch is drawn and at what level of detail
+uniform vec2 chunk_start;
+uniform float lod_step;
+
+//Vertices slide into the next level of detail from morph_start away from the eye
+uniform vec3 eye_position;
+uniform float morph_start;
+uniform float morph_scale;
+
+uniform float skirt_depth;
+uniform float normal_scale;
+uniform vec2 height_texcoord; //Scale and offset from a height to the height texture
+uniform float texcoord_scale;
+
+in vec3 a_Vertex; //Grid steps from the chunk's corner, y is 1 for a skirt
+
+out vec4 color;
+out vec2 texCoord0;
+out float texCoord1;
+
+float getHeight(ivec2 grid)
+{
+	return texelFetch(heightfield, clamp(grid, ivec2(0), ivec2(grid_width - 1)), 0).r;
+}
+
+//The same central difference the terrain uses when it builds the normals itself
+vec3 getNormal(ivec2 grid)
+{
+	float left = getHeight(grid - ivec2(1, 0));
+	float right = getHeight(grid + ivec2(1, 0));
+	float above = getHeight(grid - ivec2(0, 1));
+	float below = getHeight(grid + ivec2(0, 1));
+	return normalize(vec3((left - right) * normal_scale, 2.0, (above - below) * normal_scale));
+}
+
+void main(void) 
+{
+	float halfWidth = float(grid_width) * 0.5;
+	ivec2 grid = ivec2(chunk_start + a_Vertex.xz);
+	float height = getHeight(grid);
+
+	/*
+		The vertices the next level of detail leaves out slide onto the
+		corner of their square at that level, so by the time the chunk
+		switches over it already looks the same
+	*/
+	vec3 world = vec3(float(grid.x) - halfWidth, height, float(grid.y) - halfWidth);
+	float morph = clamp((distance(world, eye_position) - morph_start) * morph_scale, 0.0, 1.0);
+
+	vec2 toCoarse = mod(a_Vertex.xz, 2.0 * lod_step);
+	ivec2 coarse = grid - ivec2(toCoarse);
+	vec2 position = vec2(grid) - (toCoarse * morph);
+	height = mix(height, getHeight(coarse), morph);
+
+	vec3 N = normalize(normal_matrix * normalize(mix(getNormal(grid), getNormal(coarse), morph)));
+	vec3 L = normalize(modelview_matrix * light0.position).xyz;
+	float NdotL = max(dot(N, L.xyz), 0.0);
+
+	vec4 finalColor = material_ambient * light0.ambient;
+	vec4 pos = modelview_matrix * vec4(position.x - halfWidth, height - (a_Vertex.y * skirt_depth), position.y - halfWidth, 1.0);
+	vec3 E = -pos.xyz;
+
+	if (NdotL > 0.0) 
+	{
+		vec3 HV = normalize(L + E);
+		finalColor += material_diffuse * light0.diffuse * NdotL;
+
+		float NdotHV = max(dot(N, HV), 0.0);
+		color += material_specular * light0.specular * pow(NdotHV, material_shininess);	
+	}
+
+	color = finalColor;
+	texCoord0 = (position / float(grid_width)) * texcoord_scale;
+	texCoord1 = (height * height_texcoord.x) + height_texcoord.y;
+
+	gl_Position = projection_matrix * pos;	
+}
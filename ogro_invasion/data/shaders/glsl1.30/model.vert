@@ -1,16 +1,20 @@
-#version 130
-
-uniform mat4 projection_matrix;
-uniform mat4 modelview_matrix;
-
-in vec3 a_Vertex;
-in vec2 a_TexCoord0;
-
-out vec2 texCoord0;
-
-void main(void) 
-{
-	vec4 pos = modelview_matrix * vec4(a_Vertex, 1.0);	
-	texCoord0 = a_TexCoord0;
-	gl_Position = projection_matrix * pos;	
-}
+#version 130
+
+uniform mat4 projection_matrix;
+uniform mat4 modelview_matrix;
+uniform float interpolation;
+
+in vec3 a_Vertex;
+in vec2 a_TexCoord0;
+in vec3 a_NextVertex;
+
+out vec2 texCoord0;
+
+void main(void) 
+{
+	//Blend between the current and next key frames
+	vec3 vertex = mix(a_Vertex, a_NextVertex, interpolation);
+	vec4 pos = modelview_matrix * vec4(vertex, 1.0);	
+	texCoord0 = a_TexCoord0;
+	gl_Position = projection_matrix * pos;	
+}
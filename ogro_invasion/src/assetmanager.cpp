@@ -0,0 +1,194 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <iostream>
+#include <cassert>
+
+#include "assetmanager.h"
+#include "md2model.h"
+#include "glslshader.h"
+#include "targa.h"
+
+using std::string;
+
+AssetManager::AssetManager(bool headless):
+m_headless(headless)
+{
+}
+
+AssetManager::~AssetManager()
+{
+    //Free everything, whether it is still referenced or not
+    for (ModelMap::iterator it = m_models.begin(); it != m_models.end(); ++it)
+    {
+        delete (*it).second.resource;
+    }
+
+    for (TextureMap::iterator it = m_textures.begin(); it != m_textures.end(); ++it)
+    {
+        glDeleteTextures(1, &(*it).second.resource);
+    }
+
+    for (ShaderMap::iterator it = m_shaders.begin(); it != m_shaders.end(); ++it)
+    {
+        delete (*it).second.resource;
+    }
+}
+
+MD2Mesh* AssetManager::acquireModel(const string& filename, const string& vertexShader,
+                                    const string& fragmentShader)
+{
+    const string key = filename + "|" + vertexShader + "|" + fragmentShader;
+
+    ModelMap::iterator it = m_models.find(key);
+    if (it != m_models.end())
+    {
+        (*it).second.refCount++;
+        return (*it).second.resource;
+    }
+
+    //Without a shader the mesh is only loaded into system memory
+    GLSLProgram* shader = NULL;
+    if (!m_headless)
+    {
+        shader = acquireShader(vertexShader, fragmentShader);
+        if (!shader)
+        {
+            return NULL;
+        }
+    }
+
+    MD2Mesh* model = new MD2Mesh();
+    if (!model->load(filename, shader))
+    {
+        std::cerr << "Could not load the model: " << filename << std::endl;
+        delete model;
+        if (shader)
+        {
+            releaseShader(shader);
+        }
+        return NULL;
+    }
+
+    Asset<MD2Mesh*> asset;
+    asset.resource = model;
+    asset.refCount = 1;
+    m_models.insert(std::make_pair(key, asset));
+
+    return model;
+}
+
+void AssetManager::releaseModel(const MD2Mesh* model)
+{
+    for (ModelMap::iterator it = m_models.begin(); it != m_models.end(); ++it)
+    {
+        if ((*it).second.resource == model)
+        {
+            assert((*it).second.refCount > 0);
+            (*it).second.refCount--;
+            return;
+        }
+    }
+}
+
+GLuint AssetManager::acquireTexture(const string& filename)
+{
+    if (m_headless)
+    {
+        return 0; //Nothing is drawn so there's no point reading the image
+    }
+
+    TextureMap::iterator it = m_textures.find(filename);
+    if (it != m_textures.end())
+    {
+        (*it).second.refCount++;
+        return (*it).second.resource;
+    }
+
+    //The image is only needed until it has been sent to OpenGL
+    TargaImage image;
+    if (!image.load(filename))
+    {
+        std::cerr << "Could not load the texture: " << filename << std::endl;
+        return 0;
+    }
+
+    GLuint textureID = 0;
+    glGenTextures(1, &textureID);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+    GLenum format = image.getType();
+    GLint internalFormat = (format == GL_RGBA) ? GL_RGBA8 : GL_RGB8;
+    gluBuild2DMipmaps(GL_TEXTURE_2D, internalFormat, image.getWidth(),
+                      image.getHeight(), format, GL_UNSIGNED_BYTE,
+                      image.getImageData());
+
+    Asset<GLuint> asset;
+    asset.resource = textureID;
+    asset.refCount = 1;
+    m_textures.insert(std::make_pair(filename, asset));
+
+    return textureID;
+}
+
+void AssetManager::releaseTexture(GLuint texture)
+{
+    for (TextureMap::iterator it = m_textures.begin(); it != m_textures.end(); ++it)
+    {
+        if ((*it).second.resource == texture)
+        {
+            assert((*it).second.refCount > 0);
+            (*it).second.refCount--;
+            return;
+        }
+    }
+}
+
+GLSLProgram* AssetManager::acquireShader(const string& vertexShader, const string& fragmentShader)
+{
+    if (m_headless)
+    {
+        return NULL;
+    }
+
+    const string key = vertexShader + "|" + fragmentShader;
+
+    ShaderMap::iterator it = m_shaders.find(key);
+    if (it != m_shaders.end())
+    {
+        (*it).second.refCount++;
+        return (*it).second.resource;
+    }
+
+    GLSLProgram* shader = new GLSLProgram(vertexShader, fragmentShader);
+    if (!shader->initialize())
+    {
+        std::cerr << "Could not load the shaders: " << key << std::endl;
+        delete shader;
+        return NULL;
+    }
+
+    Asset<GLSLProgram*> asset;
+    asset.resource = shader;
+    asset.refCount = 1;
+    m_shaders.insert(std::make_pair(key, asset));
+
+    return shader;
+}
+
+void AssetManager::releaseShader(const GLSLProgram* shader)
+{
+    for (ShaderMap::iterator it = m_shaders.begin(); it != m_shaders.end(); ++it)
+    {
+        if ((*it).second.resource == shader)
+        {
+            assert((*it).second.refCount > 0);
+            (*it).second.refCount--;
+            return;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef ASSETMANAGER_H_INCLUDED
+#define ASSETMANAGER_H_INCLUDED
+
+#include <map>
+#include <string>
+#include <GL/Glew.h>
+
+#include "uncopyable.h"
+
+class MD2Mesh;
+class GLSLProgram;
+
+/**
+    Loads models, textures and shaders the first time they are asked for
+    and hands out the same copy after that, so spawning an entity
+    doesn't hit the disk, compile shaders or upload textures.
+
+    Every acquire must be matched with a release. An asset that nobody
+    holds a reference to is kept around (the next rocket will want it)
+    until the manager is destroyed.
+
+    A headless manager never touches OpenGL: meshes are loaded into
+    system memory only, and textures and shaders come back as 0/NULL.
+*/
+class AssetManager : private Uncopyable
+{
+public:
+    explicit AssetManager(bool headless = false);
+    virtual ~AssetManager();
+
+    MD2Mesh* acquireModel(const std::string& filename, const std::string& vertexShader,
+                          const std::string& fragmentShader);
+    void releaseModel(const MD2Mesh* model);
+
+    GLuint acquireTexture(const std::string& filename);
+    void releaseTexture(GLuint texture);
+
+    GLSLProgram* acquireShader(const std::string& vertexShader, const std::string& fragmentShader);
+    void releaseShader(const GLSLProgram* shader);
+
+private:
+    template <typename T>
+    struct Asset
+    {
+        T resource;
+        int refCount;
+    };
+
+    typedef std::map<std::string, Asset<MD2Mesh*> > ModelMap;
+    typedef std::map<std::string, Asset<GLuint> > TextureMap;
+    typedef std::map<std::string, Asset<GLSLProgram*> > ShaderMap;
+
+    ModelMap m_models;
+    TextureMap m_textures;
+    ShaderMap m_shaders;
+
+    bool m_headless;
+};
+
+#endif // ASSETMANAGER_H_INCLUDED
@@ -0,0 +1,335 @@
+/**
+    Plays a scripted game with a fixed random seed and fixed time step
+    and reports how long each part of the frame took as JSON, so two
+    builds can be compared run against run.
+
+    Usage: ogro_bench [--frames <count>] [--seed <seed>] [--script <file>]
+                      [--output <file>] [--trace <file>] [--headless]
+                      [--displaced-terrain]
+
+    Without --script a built in script of walking, turning and firing is
+    played. --headless skips the window, so only the update and collision
+    phases are measured.
+*/
+
+#include "glxwindow.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include "example.h"
+#include "gameworld.h"
+#include "inputscript.h"
+#include "scriptedinput.h"
+#include "timer.h"
+#include "profiler.h"
+
+using std::vector;
+using std::string;
+
+const int DEFAULT_FRAME_COUNT = 60 * 60; //A minute of play
+const unsigned int DEFAULT_SEED = 1234;
+const float SIMULATION_STEP = 1.0f / 60.0f;
+
+const int WINDOW_WIDTH = 1024;
+const int WINDOW_HEIGHT = 768;
+
+/**
+    Nearest rank percentile, samples must be sorted
+*/
+double percentile(const vector<double>& samples, double percent)
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+
+    int rank = (int)ceil((percent / 100.0) * samples.size());
+    if (rank < 1) rank = 1;
+    return samples[rank - 1];
+}
+
+/**
+    Makes a string safe to put between quotes in the JSON, e.g. a Windows
+    path full of backslashes
+*/
+string escapeJSON(const string& text)
+{
+    std::ostringstream escaped;
+    for (string::const_iterator it = text.begin(); it != text.end(); ++it)
+    {
+        const unsigned char c = (unsigned char)(*it);
+        switch (c)
+        {
+            case '"': escaped << "\\\""; break;
+            case '\\': escaped << "\\\\"; break;
+            case '\n': escaped << "\\n"; break;
+            case '\r': escaped << "\\r"; break;
+            case '\t': escaped << "\\t"; break;
+            default:
+                if (c < 0x20)
+                {
+                    escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+                }
+                else
+                {
+                    escaped << *it;
+                }
+            break;
+        }
+    }
+    return escaped.str();
+}
+
+void writePhase(std::ostream& out, const string& name, vector<double> samples, bool last)
+{
+    std::sort(samples.begin(), samples.end());
+
+    double total = 0.0;
+    for (vector<double>::const_iterator it = samples.begin(); it != samples.end(); ++it)
+    {
+        total += (*it);
+    }
+
+    const double MILLISECONDS = 1000.0;
+    double mean = samples.empty() ? 0.0 : total / samples.size();
+    double max = samples.empty() ? 0.0 : samples.back();
+
+    out << "    \"" << name << "\": { "
+        << "\"p50_ms\": " << percentile(samples, 50.0) * MILLISECONDS << ", "
+        << "\"p95_ms\": " << percentile(samples, 95.0) * MILLISECONDS << ", "
+        << "\"p99_ms\": " << percentile(samples, 99.0) * MILLISECONDS << ", "
+        << "\"mean_ms\": " << mean * MILLISECONDS << ", "
+        << "\"max_ms\": " << max * MILLISECONDS << " }"
+        << (last ? "" : ",") << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    int frameCount = DEFAULT_FRAME_COUNT;
+    unsigned int seed = DEFAULT_SEED;
+    string scriptFile;
+    string outputFile;
+    string traceFile;
+    bool headless = false;
+    bool displacedTerrain = false;
+    bool badArgument = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--headless")
+        {
+            headless = true;
+        }
+        else if (arg == "--displaced-terrain")
+        {
+            displacedTerrain = true;
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            frameCount = atoi(argv[++i]);
+        }
+        else if (arg == "--seed" && hasValue)
+        {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        }
+        else if (arg == "--script" && hasValue)
+        {
+            scriptFile = argv[++i];
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            outputFile = argv[++i];
+        }
+        else if (arg == "--trace" && hasValue)
+        {
+            traceFile = argv[++i];
+        }
+        else
+        {
+            badArgument = true;
+            break;
+        }
+    }
+
+    if (badArgument || frameCount <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--frames <count>] [--seed <seed>] [--script <file>]"
+                  << " [--output <file>] [--trace <file>] [--headless] [--displaced-terrain]" << std::endl;
+        return 1;
+    }
+
+    InputScript script;
+    if (scriptFile.empty())
+    {
+        script.loadDefault(frameCount);
+    }
+    else if (!script.load(scriptFile))
+    {
+        return 1;
+    }
+
+    ScriptedKeyboardInterface keyboard;
+    ScriptedMouseInterface mouse;
+
+    SimpleGLXWindow window;
+    std::auto_ptr<Example> example;
+    std::auto_ptr<GameWorld> headlessWorld;
+    GameWorld* world = NULL;
+
+    try
+    {
+        if (headless)
+        {
+            headlessWorld = std::auto_ptr<GameWorld>(new GameWorld(&keyboard, &mouse, true));
+            world = headlessWorld.get();
+            world->setRandomSeed(seed);
+            world->setViewport(WINDOW_WIDTH, WINDOW_HEIGHT);
+
+            if (!world->initialize())
+            {
+                std::cerr << "Could not initialize the game world" << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            window.create(WINDOW_WIDTH, WINDOW_HEIGHT, 16, false);
+
+            example = std::auto_ptr<Example>(new Example(&window, &keyboard, &mouse));
+            world = example->getWorld();
+            world->setRandomSeed(seed);
+            world->setTerrainDisplaced(displacedTerrain);
+
+            if (!example->init())
+            {
+                window.destroy();
+                return 1;
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    //Start the cursor where the game expects it so the player doesn't spin on the first step
+    mouse.setMousePos(world->getViewportWidth() / 2, world->getViewportHeight() / 2);
+
+    vector<double> updateTimes, collisionTimes, renderTimes, hudTimes, frameTimes;
+    updateTimes.reserve(frameCount);
+    collisionTimes.reserve(frameCount);
+    renderTimes.reserve(frameCount);
+    hudTimes.reserve(frameCount);
+    frameTimes.reserve(frameCount);
+
+    unsigned int peakEntityCount = 0;
+
+    Timer frameTimer;
+    for (int frame = 0; frame < frameCount; ++frame)
+    {
+        frameTimer.reset();
+
+        //The same order the window uses: last state, then this frame's input
+        keyboard.update();
+        mouse.update();
+        script.apply(frame, &keyboard, &mouse);
+
+        Timer phaseTimer;
+        world->update(SIMULATION_STEP);
+        double updateTime = phaseTimer.getElapsedSeconds();
+
+        //The collision pass happens inside update, report it separately
+        collisionTimes.push_back(world->getLastCollisionTime());
+        updateTimes.push_back(updateTime - world->getLastCollisionTime());
+
+        if (!headless)
+        {
+            phaseTimer.reset();
+            example->renderScene(1.0f);
+            renderTimes.push_back(phaseTimer.getElapsedSeconds());
+
+            phaseTimer.reset();
+            example->renderHUD();
+            hudTimes.push_back(phaseTimer.getElapsedSeconds());
+
+            {
+                PROFILE_ZONE("glfwSwapBuffers");
+                glfwSwapBuffers(window.GetWindow());
+            }
+            glfwPollEvents();
+        }
+
+        frameTimes.push_back(frameTimer.getElapsedSeconds());
+        peakEntityCount = std::max(peakEntityCount, world->getEntityCount());
+    }
+
+    if (!traceFile.empty())
+    {
+        Profiler::get().writeChromeTrace(traceFile);
+    }
+
+    std::ofstream fileOut;
+    if (!outputFile.empty())
+    {
+        fileOut.open(outputFile.c_str());
+        if (!fileOut.good())
+        {
+            std::cerr << "Could not open " << outputFile << " for writing" << std::endl;
+            return 1;
+        }
+    }
+
+    std::ostream& out = outputFile.empty() ? std::cout : fileOut;
+    out << std::fixed << std::setprecision(4);
+
+    out << "{" << std::endl;
+    out << "  \"frames\": " << frameCount << "," << std::endl;
+    out << "  \"seed\": " << seed << "," << std::endl;
+    out << "  \"step_ms\": " << SIMULATION_STEP * 1000.0f << "," << std::endl;
+    out << "  \"headless\": " << (headless ? "true" : "false") << "," << std::endl;
+    out << "  \"script\": \"" << (scriptFile.empty() ? "default" : escapeJSON(scriptFile)) << "\"," << std::endl;
+
+    out << "  \"phases\": {" << std::endl;
+    writePhase(out, "update", updateTimes, false);
+    writePhase(out, "collision", collisionTimes, false);
+    if (!headless)
+    {
+        writePhase(out, "render_submission", renderTimes, false);
+        writePhase(out, "hud_text", hudTimes, false);
+    }
+    writePhase(out, "frame", frameTimes, true);
+    out << "  }," << std::endl;
+
+    out << "  \"entities\": {" << std::endl;
+    out << "    \"peak\": " << peakEntityCount << "," << std::endl;
+    out << "    \"final\": " << world->getEntityCount() << "," << std::endl;
+    out << "    \"ogros\": " << world->getEntityCount(OGRO) << "," << std::endl;
+    out << "    \"rockets\": " << world->getEntityCount(ROCKET) << "," << std::endl;
+    out << "    \"explosions\": " << world->getEntityCount(EXPLOSION) << "," << std::endl;
+    out << "    \"trees\": " << world->getEntityCount(TREE) << std::endl;
+    out << "  }" << std::endl;
+    out << "}" << std::endl;
+
+    if (example.get())
+    {
+        example->shutdown();
+        example.reset();
+        glfwTerminate();
+    }
+
+    return 0;
+}
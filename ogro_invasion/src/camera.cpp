@@ -92,9 +92,9 @@ float* Camera::GetMVPMatrix()
 void Camera::apply()
 {
     if (m_attachedEntity != NULL) {
-        setPosition(m_attachedEntity->getPosition());
-        m_yaw = m_attachedEntity->getYaw();
-        m_pitch = m_attachedEntity->getPitch();
+        setPosition(m_attachedEntity->getRenderPosition());
+        m_yaw = m_attachedEntity->getRenderYaw();
+        m_pitch = m_attachedEntity->getRenderPitch();
     }
 
     float cosYaw = cosf(degreesToRadians(m_yaw));
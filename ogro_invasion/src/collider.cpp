@@ -1,39 +1,180 @@
 #include "entity.h"
 #include "collider.h"
+#include "collisiongrid.h"
+#include "entitystore.h"
+#include "narrowphase.h"
+#include "staticbvh.h"
+#include "profiler.h"
 
-using std::list;
+using std::vector;
+
+#define LAYER(type) (1u << (type))
+
+/**
+    Which layers each entity type collides with, in the same order as
+    EntityType. Only pairs that do something when they meet are listed:
+    the terrain pushes moving things up out of it, rockets blow up on
+    anything but the player and ogros die when a rocket hits them. Both
+    sides of a pair must list each other.
+*/
+static const unsigned int COLLISION_MASKS[] =
+{
+    LAYER(LANDSCAPE) | LAYER(ROCKET),                               //OGRO
+    LAYER(LANDSCAPE),                                               //PLAYER
+    LAYER(OGRO) | LAYER(ROCKET) | LAYER(LANDSCAPE) | LAYER(TREE),   //ROCKET
+    0,                                                              //EXPLOSION
+    LAYER(OGRO) | LAYER(PLAYER) | LAYER(ROCKET),                    //LANDSCAPE
+    LAYER(ROCKET)                                                   //TREE
+};
 
 Collider::Collider(Entity* entity):
-m_entity(entity)
+m_entity(entity),
+m_timeOfImpact(1.0f),
+m_continuous(false),
+m_layer(~0u),
+m_mask(~0u)
+{
+}
+
+void Collider::setLayer(EntityType type)
 {
+    m_layer = LAYER(type);
+    m_mask = COLLISION_MASKS[type];
 }
 
-void Collider::updateColliders(list<Collider*>& colliders)
+/**
+    Collides everything in the store. The broadphase and narrowphase read
+    the positions and radii straight out of its arrays. Each collider goes
+    in the grid covering the whole path its entity took during the step.
+    Static entities are left out of the grid, the moving colliders look
+    them up in the hierarchy instead.
+*/
+void Collider::updateColliders(const EntityStore& entities, const StaticBVH& statics,
+                               CollisionGrid& grid, Narrowphase& narrowphase)
 {
-    typedef list<Collider*>::iterator CollisionIterator;
-    for(CollisionIterator collider = colliders.begin(); collider != colliders.end(); ++collider)
+    PROFILE_ZONE("Collider::updateColliders");
+
+    grid.clear();
+    for (unsigned int i = 0; i < entities.getCount(); ++i)
+    {
+        //If the attached entity is dead there's no need to test it
+        //Static entities are in the hierarchy instead
+        Collider* collider = entities.getCollider(i);
+        if (!collider || entities.canBeRemoved(i) || entities.isStatic(i))
+        {
+            continue;
+        }
+
+        if (entities.isBounded(i))
+        {
+            //A circle around both ends of the path
+            const Vector3 position = entities.getPosition(i);
+            const Vector3 previous = entities.getPreviousPosition(i);
+            const float halfX = (position.x - previous.x) * 0.5f;
+            const float halfZ = (position.z - previous.z) * 0.5f;
+            const float radius = entities.getRadius(i) + sqrtf(halfX * halfX + halfZ * halfZ);
+            grid.insert(collider, i, previous.x + halfX, previous.z + halfZ, radius);
+        }
+        else
+        {
+            grid.insertUnbounded(collider, i);
+        }
+    }
+
+    const vector<Collider*>& unbounded = grid.getUnboundedColliders();
+    for (vector<Collider*>::const_iterator collider = unbounded.begin(); collider != unbounded.end(); ++collider)
+    {
+        (*collider)->prepareCollisions(grid);
+    }
+
+    narrowphase.clear();
+
+    const vector<CollisionGrid::ColliderPair>& pairs = grid.findPairs();
+    for (unsigned int i = 0; i < pairs.size(); ++i)
     {
-        //If the attached entity is dead
-        if ((*collider)->getEntity()->canBeRemoved())
+        const CollisionGrid::ColliderPair& pair = pairs[i];
+
+        //Plain spheres are left to be tested together
+        if (entities.isBounded(pair.firstID) && entities.isBounded(pair.secondID) &&
+            !entities.isContinuous(pair.firstID) && !entities.isContinuous(pair.secondID))
+        {
+            narrowphase.addSpherePair(pair.firstID, pair.secondID, i);
+            continue;
+        }
+
+        //collideWith isn't symmetrical (e.g. the terrain only checks whether
+        //the other collider is below it) so we need to ask both sides
+        float timeOfImpact = 1.0f;
+        if (pair.first->collideWith(pair.second, timeOfImpact) ||
+            pair.second->collideWith(pair.first, timeOfImpact))
         {
-            continue; //Move to the next one
+            narrowphase.addContact(pair.first, pair.second, timeOfImpact, i);
         }
+    }
 
-        for(CollisionIterator other = colliders.begin(); other != colliders.end(); ++other)
+    //Then the static props near anything moving that can hit them. Their
+    //contacts come after the grid's at the same time of impact.
+    unsigned int order = pairs.size();
+    for (unsigned int i = 0; i < entities.getCount() && !statics.isEmpty(); ++i)
+    {
+        //Unbounded colliders (the terrain) don't move so never meet a prop
+        Collider* collider = entities.getCollider(i);
+        if (!collider || entities.canBeRemoved(i) || entities.isStatic(i) || !entities.isBounded(i) ||
+            !(collider->getMask() & statics.getLayers()))
         {
-            if (*other == *collider || (*other)->getEntity()->canBeRemoved())
+            continue;
+        }
+
+        //Swept colliders ask for everything along their path, the rest
+        //only need the props they overlap where they are
+        const bool continuous = entities.isContinuous(i);
+        Vector3 centre = entities.getPosition(i);
+        float radius = entities.getRadius(i);
+        if (continuous)
+        {
+            const Vector3 half = (centre - entities.getPreviousPosition(i)) * 0.5f;
+            centre = centre - half;
+            radius += sqrtf(half.x * half.x + half.y * half.y + half.z * half.z);
+        }
+
+        const vector<unsigned int>& props = statics.findProps(centre, radius);
+        for (vector<unsigned int>::const_iterator it = props.begin(); it != props.end(); ++it)
+        {
+            Collider* prop = statics.getProp(*it).collider;
+            if (!prop || !collider->canCollideWith(prop))
             {
-                //We are testing the entity against itself, or the other entity is dead
                 continue;
             }
 
-            //If we collided
-            if ((*collider)->collideWith((*other)))
+            float timeOfImpact = 1.0f;
+            if (!continuous || collider->collideWith(prop, timeOfImpact) || prop->collideWith(collider, timeOfImpact))
             {
-                //Tell both entities they collided
-                (*collider)->getEntity()->collide((*other)->getEntity());
-                (*other)->getEntity()->collide((*collider)->getEntity());
+                narrowphase.addContact(collider, prop, timeOfImpact, order);
             }
+            ++order;
+        }
+    }
+
+    //A fast entity can be swept through several things in one step, the
+    //contacts come back in time order so it hits the first one it reached
+    const vector<Narrowphase::Contact>& contacts = narrowphase.findContacts(entities);
+
+    for (vector<Narrowphase::Contact>::const_iterator contact = contacts.begin(); contact != contacts.end(); ++contact)
+    {
+        Collider* first = (*contact).first;
+        Collider* second = (*contact).second;
+
+        //One of these may have been killed by an earlier collision this frame
+        if (first->getEntity()->canBeRemoved() || second->getEntity()->canBeRemoved())
+        {
+            continue;
         }
+
+        first->m_timeOfImpact = (*contact).timeOfImpact;
+        second->m_timeOfImpact = (*contact).timeOfImpact;
+
+        //Tell both entities they collided
+        first->getEntity()->collide(second->getEntity());
+        second->getEntity()->collide(first->getEntity());
     }
 }
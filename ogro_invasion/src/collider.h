@@ -1,10 +1,16 @@
 #ifndef COLLIDER_H_INCLUDED
 #define COLLIDER_H_INCLUDED
 
-#include <list>
+#include <cstddef>
+
 #include "uncopyable.h"
+#include "entitytypes.h"
 
 class Entity;
+class EntityStore;
+class CollisionGrid;
+class Narrowphase;
+class StaticBVH;
 
 class Collider : private Uncopyable {
 public:
@@ -12,16 +18,65 @@ public:
 
     virtual float getRadius() const = 0;
     virtual void setRadius(const float radius) = 0;
-    static void updateColliders(std::list<Collider*> &colliders);
+    static void updateColliders(const EntityStore& entities, const StaticBVH& statics,
+                                CollisionGrid& grid, Narrowphase& narrowphase);
+
+    //Bounded colliders are spheres of their radius, anything else is
+    //tested against every other collider by the broadphase. Two bounded
+    //colliders that aren't continuous are only tested for overlap, by the
+    //narrowphase rather than collideWith().
+    virtual bool isBounded() const { return true; }
+
+    //Called on the unbounded colliders once the grid has been filled, before
+    //any pairs are tested, so work for every collider can be done in one go
+    virtual void prepareCollisions(const CollisionGrid& grid) { }
 
     Entity* getEntity() const { return m_entity; }
 
+    /**
+        How far through the last step (0 = where the entity started, 1 =
+        where it ended up) it first touched whatever it last collided
+        with. Colliders are swept along the path their entity moved, so a
+        fast entity is hit part way along instead of passing through.
+    */
+    float getTimeOfImpact() const { return m_timeOfImpact; }
+
+    /**
+        Only continuous colliders (fast things like rockets) are swept,
+        anything else is tested where it is. Ogros and the player sink
+        into the ground as they move and are put back by the collision
+        pass, so the path they take during a step isn't a real one.
+        Set it before the entity is spawned.
+    */
+    void setContinuous(bool continuous) { m_continuous = continuous; }
+    bool isContinuous() const { return m_continuous; }
+
+    /**
+        Each collider is on a layer (one bit per entity type) and has a
+        mask of the layers it collides with. A pair is only tested if
+        each is in the other's mask, so e.g. the trees and the terrain,
+        which never move, are never tested against each other. Until a
+        layer is set a collider is tested against everything.
+    */
+    void setLayer(EntityType type);
+    unsigned int getLayer() const { return m_layer; }
+    unsigned int getMask() const { return m_mask; }
+    bool canCollideWith(const Collider* collider) const
+    {
+        return (m_mask & collider->m_layer) && (collider->m_mask & m_layer);
+    }
+
     virtual ~Collider() { m_entity = NULL; }
 
 private:
-    virtual bool collideWith(const Collider* collider) = 0;
+    //Fills in timeOfImpact when there is a collision
+    virtual bool collideWith(const Collider* collider, float& timeOfImpact) = 0;
 
     Entity* m_entity;
+    float m_timeOfImpact;
+    bool m_continuous;
+    unsigned int m_layer;
+    unsigned int m_mask;
 };
 
 #endif // COLLIDER_H_INCLUDED
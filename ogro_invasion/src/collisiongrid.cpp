@@ -0,0 +1,163 @@
+#include <cmath>
+
+#include "entity.h"
+#include "collider.h"
+#include "collisiongrid.h"
+
+using std::vector;
+
+CollisionGrid::CollisionGrid(float minX, float maxX, float minZ, float maxZ, float cellSize):
+m_minX(minX),
+m_minZ(minZ),
+m_invCellSize(1.0f / cellSize),
+m_width(0),
+m_depth(0)
+{
+    m_width = (int)ceilf((maxX - minX) * m_invCellSize);
+    m_depth = (int)ceilf((maxZ - minZ) * m_invCellSize);
+
+    if (m_width < 1) m_width = 1;
+    if (m_depth < 1) m_depth = 1;
+
+    m_cells.resize(m_width * m_depth);
+}
+
+int CollisionGrid::cellX(float x) const
+{
+    //Anything outside the map is clamped into the border cells
+    int cell = (int)floorf((x - m_minX) * m_invCellSize);
+    if (cell < 0) return 0;
+    if (cell >= m_width) return m_width - 1;
+    return cell;
+}
+
+int CollisionGrid::cellZ(float z) const
+{
+    int cell = (int)floorf((z - m_minZ) * m_invCellSize);
+    if (cell < 0) return 0;
+    if (cell >= m_depth) return m_depth - 1;
+    return cell;
+}
+
+void CollisionGrid::clear()
+{
+    //Clearing the cells rather than reallocating them keeps their capacity
+    //so after the first few frames we don't touch the heap at all
+    for (vector<vector<int> >::iterator cell = m_cells.begin(); cell != m_cells.end(); ++cell)
+    {
+        (*cell).clear();
+    }
+
+    m_entries.clear();
+    m_bounded.clear();
+    m_unbounded.clear();
+    m_unboundedIDs.clear();
+}
+
+void CollisionGrid::insertUnbounded(Collider* collider, unsigned int id)
+{
+    m_unbounded.push_back(collider);
+    m_unboundedIDs.push_back(id);
+}
+
+//x and z are the middle of the collider
+void CollisionGrid::insert(Collider* collider, unsigned int id, float x, float z, float radius)
+{
+    Entry entry;
+    entry.collider = collider;
+    entry.id = id;
+    entry.layer = collider->getLayer();
+    entry.mask = collider->getMask();
+    entry.minX = cellX(x - radius);
+    entry.maxX = cellX(x + radius);
+    entry.minZ = cellZ(z - radius);
+    entry.maxZ = cellZ(z + radius);
+
+    int index = (int)m_entries.size();
+    m_entries.push_back(entry);
+    m_bounded.push_back(collider);
+
+    for (int z = entry.minZ; z <= entry.maxZ; ++z)
+    {
+        for (int x = entry.minX; x <= entry.maxX; ++x)
+        {
+            m_cells[(z * m_width) + x].push_back(index);
+        }
+    }
+}
+
+const vector<CollisionGrid::ColliderPair>& CollisionGrid::findPairs()
+{
+    m_pairs.clear();
+
+    for (int z = 0; z < m_depth; ++z)
+    {
+        for (int x = 0; x < m_width; ++x)
+        {
+            const vector<int>& cell = m_cells[(z * m_width) + x];
+
+            for (unsigned int i = 0; i < cell.size(); ++i)
+            {
+                const Entry& first = m_entries[cell[i]];
+
+                for (unsigned int j = i + 1; j < cell.size(); ++j)
+                {
+                    const Entry& second = m_entries[cell[j]];
+
+                    if (!(first.mask & second.layer) || !(second.mask & first.layer))
+                    {
+                        continue;
+                    }
+
+                    /*
+                        Both colliders are in this cell, but they might share
+                        others too. Only report the pair from the top-left cell
+                        of the area where they overlap so it comes out once.
+                    */
+                    int firstSharedX = (first.minX > second.minX) ? first.minX : second.minX;
+                    int firstSharedZ = (first.minZ > second.minZ) ? first.minZ : second.minZ;
+
+                    if (firstSharedX == x && firstSharedZ == z)
+                    {
+                        addPair(first.collider, first.id, second.collider, second.id);
+                    }
+                }
+            }
+        }
+    }
+
+    //Unbounded colliders could touch anything
+    for (unsigned int i = 0; i < m_unbounded.size(); ++i)
+    {
+        const unsigned int layer = m_unbounded[i]->getLayer();
+        const unsigned int mask = m_unbounded[i]->getMask();
+
+        for (unsigned int j = i + 1; j < m_unbounded.size(); ++j)
+        {
+            if (m_unbounded[i]->canCollideWith(m_unbounded[j]))
+            {
+                addPair(m_unbounded[i], m_unboundedIDs[i], m_unbounded[j], m_unboundedIDs[j]);
+            }
+        }
+
+        for (vector<Entry>::const_iterator entry = m_entries.begin(); entry != m_entries.end(); ++entry)
+        {
+            if ((mask & (*entry).layer) && ((*entry).mask & layer))
+            {
+                addPair(m_unbounded[i], m_unboundedIDs[i], (*entry).collider, (*entry).id);
+            }
+        }
+    }
+
+    return m_pairs;
+}
+
+void CollisionGrid::addPair(Collider* first, unsigned int firstID, Collider* second, unsigned int secondID)
+{
+    ColliderPair pair;
+    pair.first = first;
+    pair.second = second;
+    pair.firstID = firstID;
+    pair.secondID = secondID;
+    m_pairs.push_back(pair);
+}
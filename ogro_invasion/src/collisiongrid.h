@@ -0,0 +1,88 @@
+#ifndef COLLISIONGRID_H_INCLUDED
+#define COLLISIONGRID_H_INCLUDED
+
+#include <vector>
+#include "uncopyable.h"
+
+class Collider;
+
+/**
+    A uniform grid laid over the XZ extents of the terrain, used as the
+    collision broadphase. Each frame every collider is dropped into the
+    cells its bounding square overlaps, and only colliders that share a
+    cell are handed on to the (more expensive) collideWith() test.
+
+    A pair of colliders can share several cells, so a pair is only
+    reported from the first cell of the region where the two overlap.
+    That way each candidate pair comes out exactly once without needing
+    a set to filter duplicates.
+
+    Colliders that aren't bounded (the terrain) can't be placed in a
+    cell, they are paired with everything instead. Pairs whose layers
+    don't collide (see Collider::setLayer()) are never reported.
+
+    Each collider is given an id when it's inserted (the world uses its
+    index in the entity store), the pairs carry them so the narrowphase
+    can find the colliders' data without going through the colliders.
+*/
+class CollisionGrid : private Uncopyable
+{
+public:
+    struct ColliderPair
+    {
+        Collider* first;
+        Collider* second;
+        unsigned int firstID;
+        unsigned int secondID;
+    };
+
+    CollisionGrid(float minX, float maxX, float minZ, float maxZ, float cellSize);
+
+    void clear();
+    void insert(Collider* collider, unsigned int id, float x, float z, float radius);
+    void insertUnbounded(Collider* collider, unsigned int id);
+
+    /**
+        Returns every pair of colliders that might be touching, the
+        returned vector is reused so it is only valid until the next call
+    */
+    const std::vector<ColliderPair>& findPairs();
+
+    //Everything inserted since the last clear(), in the order it was inserted
+    const std::vector<Collider*>& getBoundedColliders() const { return m_bounded; }
+    const std::vector<Collider*>& getUnboundedColliders() const { return m_unbounded; }
+
+    int getWidth() const { return m_width; }
+    int getDepth() const { return m_depth; }
+
+private:
+    struct Entry
+    {
+        Collider* collider;
+        unsigned int id;
+        unsigned int layer;
+        unsigned int mask;
+        int minX, minZ;
+        int maxX, maxZ;
+    };
+
+    int cellX(float x) const;
+    int cellZ(float z) const;
+    void addPair(Collider* first, unsigned int firstID, Collider* second, unsigned int secondID);
+
+    float m_minX;
+    float m_minZ;
+    float m_invCellSize;
+
+    int m_width;
+    int m_depth;
+
+    std::vector<Entry> m_entries;
+    std::vector<std::vector<int> > m_cells; //Indices into m_entries
+    std::vector<Collider*> m_bounded;
+    std::vector<Collider*> m_unbounded;
+    std::vector<unsigned int> m_unboundedIDs;
+    std::vector<ColliderPair> m_pairs;
+};
+
+#endif // COLLISIONGRID_H_INCLUDED
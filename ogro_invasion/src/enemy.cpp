@@ -6,9 +6,7 @@
 Enemy::Enemy(GameWorld* world):
 Entity(world),
 m_collider(NULL),
-m_position(Vector3()),
 m_velocity(Vector3()),
-m_yaw(0.0f),
 m_isDead(false)
 {
     //Should probably be moved to onInitialize where we will have access to the model radius
@@ -18,15 +18,8 @@ public:
     virtual void onCollision(Entity* collider);
 
 
-    Vector3 getPosition() const { return m_position; }
-    void setPosition(const Vector3& pos) { m_position = pos; }
     Vector3 getVelocity() const { return m_velocity; }
 
-    float getYaw() const { return m_yaw; }
-    float getPitch() const { return 0.0f; }
-    void setYaw(const float yaw) { m_yaw = yaw; }
-    void setPitch(const float pitch) {  }
-
     void kill()
     {
         m_isDead = true;
@@ -43,11 +36,8 @@ public:
 protected:
     Collider* m_collider;
 
-    Vector3 m_position;
     Vector3 m_velocity;
 
-    float m_yaw;
-
     bool m_isDead;
 
 private:
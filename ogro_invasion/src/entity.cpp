@@ -1,9 +1,43 @@
+#include <cstdlib>
+
 #include "entity.h"
+#include "entitystore.h"
+#include "collider.h"
+#include "gameworld.h"
+#include "profiler.h"
+
+//Zone names for each entity type, in the same order as EntityType
+static const char* const PREPARE_ZONES[] =
+{
+    "Ogro::onPrepare", "Player::onPrepare", "Rocket::onPrepare",
+    "Explosion::onPrepare", "Landscape::onPrepare", "Tree::onPrepare"
+};
+
+static const char* const RENDER_ZONES[] =
+{
+    "Ogro::onRender", "Player::onRender", "Rocket::onRender",
+    "Explosion::onRender", "Landscape::onRender", "Tree::onRender"
+};
 
 Entity::Entity(GameWorld* const gameWorld):
+m_world(gameWorld),
+m_store(NULL),
+m_storeSlot(0),
+m_yaw(0.0f),
+m_pitch(0.0f),
+m_radius(0.0f),
 m_canBeRemoved(false),
-m_world(gameWorld)
+m_previousYaw(0.0f),
+m_previousPitch(0.0f),
+m_hasPreviousState(false),
+m_randomState(0)
 {
+    //Entities are only created on one thread at a time so rand() is safe here
+    m_randomState = ((unsigned int)rand() << 16) ^ (unsigned int)rand();
+    if (m_randomState == 0)
+    {
+        m_randomState = 1;
+    }
 
 }
 
@@ -14,21 +48,180 @@ Entity::~Entity()
 
 bool Entity::canBeRemoved() const
 {
-    return m_canBeRemoved;
+    return m_store ? m_store->canBeRemoved(m_storeSlot) : m_canBeRemoved;
 }
 
 void Entity::destroy()
 {
-    m_canBeRemoved = true;
+    if (canBeRemoved())
+    {
+        return; //Already on its way out
+    }
+
+    if (m_store)
+    {
+        m_store->setCanBeRemoved(m_storeSlot, true);
+    }
+    else
+    {
+        m_canBeRemoved = true;
+    }
+
+    m_world->destroyEntity(this);
 }
 
+void Entity::respawn()
+{
+    //Pooled entities are respawned before they go back in the world
+    m_canBeRemoved = false;
+    m_hasPreviousState = false;
+    onRespawn();
+}
+
+//The world saves the state at the start of the step for all of them at once, see EntityStore::savePreviousState()
 void Entity::prepare(float dt)
 {
+    PROFILE_ZONE(PREPARE_ZONES[getType()]);
     onPrepare(dt);
 }
 
+Vector3 Entity::getPosition() const
+{
+    return m_store ? m_store->getPosition(m_storeSlot) : m_position;
+}
+
+void Entity::setPosition(const Vector3& position)
+{
+    if (m_store)
+    {
+        m_store->setPosition(m_storeSlot, position);
+    }
+    else
+    {
+        m_position = position;
+    }
+
+    onMove();
+}
+
+float Entity::getYaw() const
+{
+    return m_store ? m_store->getYaw(m_storeSlot) : m_yaw;
+}
+
+void Entity::setYaw(const float yaw)
+{
+    if (m_store)
+    {
+        m_store->setYaw(m_storeSlot, yaw);
+    }
+    else
+    {
+        m_yaw = yaw;
+    }
+}
+
+float Entity::getPitch() const
+{
+    return m_store ? m_store->getPitch(m_storeSlot) : m_pitch;
+}
+
+void Entity::setPitch(const float pitch)
+{
+    if (m_store)
+    {
+        m_store->setPitch(m_storeSlot, pitch);
+    }
+    else
+    {
+        m_pitch = pitch;
+    }
+}
+
+float Entity::getRadius() const
+{
+    return m_store ? m_store->getRadius(m_storeSlot) : m_radius;
+}
+
+void Entity::setRadius(const float radius)
+{
+    if (m_store)
+    {
+        m_store->setRadius(m_storeSlot, radius);
+    }
+    else
+    {
+        m_radius = radius;
+    }
+}
+
+void Entity::resetInterpolation()
+{
+    if (m_store)
+    {
+        m_store->resetPreviousState(m_storeSlot);
+    }
+    else
+    {
+        m_hasPreviousState = false;
+    }
+}
+
+int Entity::random()
+{
+    //xorshift32
+    m_randomState ^= m_randomState << 13;
+    m_randomState ^= m_randomState >> 17;
+    m_randomState ^= m_randomState << 5;
+    return (int)(m_randomState >> 1);
+}
+
+/**
+    Blends between two angles in degrees, taking the short way
+    round when one of them has wrapped past 360
+*/
+static float interpolateAngle(float from, float to, float t)
+{
+    float delta = to - from;
+    if (delta > 180.0f) delta -= 360.0f;
+    if (delta < -180.0f) delta += 360.0f;
+
+    return from + delta * t;
+}
+
+Vector3 Entity::getPreviousPosition() const
+{
+    if (m_store)
+    {
+        return m_store->getPreviousPosition(m_storeSlot);
+    }
+
+    return m_hasPreviousState ? m_previousPosition : m_position;
+}
+
+Vector3 Entity::getRenderPosition() const
+{
+    Vector3 current = getPosition();
+    Vector3 previous = getPreviousPosition();
+
+    return previous + ((current - previous) * m_world->getRenderInterpolation());
+}
+
+float Entity::getRenderYaw() const
+{
+    float previous = m_store ? m_store->getPreviousYaw(m_storeSlot) : (m_hasPreviousState ? m_previousYaw : m_yaw);
+    return interpolateAngle(previous, getYaw(), m_world->getRenderInterpolation());
+}
+
+float Entity::getRenderPitch() const
+{
+    float previous = m_store ? m_store->getPreviousPitch(m_storeSlot) : (m_hasPreviousState ? m_previousPitch : m_pitch);
+    return interpolateAngle(previous, getPitch(), m_world->getRenderInterpolation());
+}
+
 void Entity::render() const
 {
+    PROFILE_ZONE(RENDER_ZONES[getType()]);
     onRender();
 }
 
@@ -39,6 +232,11 @@ void Entity::postRender()
 
 bool Entity::initialize()
 {
+    if (getCollider())
+    {
+        getCollider()->setLayer(getType());
+    }
+
     return onInitialize();
 }
 
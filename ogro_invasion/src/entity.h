@@ -7,6 +7,7 @@
 
 class GameWorld;
 class Collider;
+class EntityStore;
 
 /**
     The entity is uncopyable because we will mainly be handling
@@ -21,10 +22,35 @@ class Entity : private Uncopyable {
         virtual bool onInitialize() = 0;
         virtual void onShutdown() = 0;
         virtual void onCollision(Entity* collider) = 0;
+        virtual void onRespawn() { }
+        virtual void onMove() { } //Called after setPosition()
 
+        GameWorld* m_world;
+
+        /**
+            While the entity is in the world its state is kept in the
+            world's EntityStore (which moves it in and out, so it's a
+            friend) and these aren't used. They hold it the rest of the
+            time, before the entity is spawned and while it's in a pool.
+        */
+        friend class EntityStore;
+        EntityStore* m_store;
+        unsigned int m_storeSlot;
+
+        Vector3 m_position;
+        float m_yaw;
+        float m_pitch;
+        float m_radius;
         bool m_canBeRemoved;
 
-        GameWorld* m_world;
+        //The state at the start of the last simulation step, used to
+        //smooth rendering between two fixed steps
+        Vector3 m_previousPosition;
+        float m_previousYaw;
+        float m_previousPitch;
+        bool m_hasPreviousState;
+
+        unsigned int m_randomState;
     public:
         Entity(GameWorld* const gameWorld);
         virtual ~Entity();
@@ -36,23 +62,74 @@ class Entity : private Uncopyable {
         void shutdown();
         bool canBeRemoved() const;
         float* GetMVP() const;
+
+        //Marks the entity as dead, the world takes it out at the end of the current stage
         void destroy();
 
+        //Puts a removed entity back the way it was after initialize(), so a pool can hand it out again
+        void respawn();
+
         void collide(Entity* collider);
 
-        virtual Vector3 getPosition() const = 0;
+        Vector3 getPosition() const;
         //virtual Vector3 getVelocity() const = 0;
-        virtual void setPosition(const Vector3& position) = 0;
-        virtual float getYaw() const = 0;
-        virtual float getPitch() const = 0;
-        virtual void setYaw(const float yaw) = 0;
-        virtual void setPitch(const float pitch) = 0;
+        void setPosition(const Vector3& position);
+        float getYaw() const;
+        float getPitch() const;
+        void setYaw(const float yaw);
+        void setPitch(const float pitch);
+
+        //How far out the entity's collider reaches, 0 for anything without one
+        float getRadius() const;
+        void setRadius(const float radius);
 
         virtual Collider* getCollider() = 0;
 
         virtual EntityType getType() const = 0;
     
         virtual void SetMVP(float* mvp);
+
+        /**
+            The simulation runs at a fixed rate so rendering usually falls
+            between two steps. These blend the state from the start of the
+            last step with the current state using the world's render
+            interpolation (0 = previous step, 1 = current).
+        */
+        Vector3 getRenderPosition() const;
+        float getRenderYaw() const;
+        float getRenderPitch() const;
+
+        //Where the last step started from, or where it is now if it hasn't been stepped yet
+        Vector3 getPreviousPosition() const;
+
+        //Call after teleporting an entity so it doesn't get smeared across the map
+        void resetInterpolation();
+
+        //Where the entity is in the world's EntityStore, only meaningful while it's in the world
+        unsigned int getStoreSlot() const { return m_storeSlot; }
+
+        /**
+            Entities are prepared in parallel unless this returns false, in
+            which case they are prepared first, one at a time. Anything that
+            spawns entities or that other entities read from while they are
+            being prepared must be serial.
+        */
+        virtual bool canPrepareInParallel() const { return true; }
+
+        /**
+            Static entities never move once they've been placed. The world
+            keeps them in a hierarchy for collisions and culling instead of
+            testing them one by one, so they must be given their position
+            as soon as they are spawned and never moved after that.
+        */
+        virtual bool isStatic() const { return false; }
+
+        /**
+            A random number (0 to 2^31 - 1) from this entity's own generator.
+            rand() is shared between threads, so anything random in onPrepare
+            should use this to keep the game the same from run to run.
+        */
+        int random();
     
         float* m_mvp;
     
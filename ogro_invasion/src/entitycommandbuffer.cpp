@@ -0,0 +1,23 @@
+#include "entitycommandbuffer.h"
+
+using std::vector;
+
+EntityCommandBuffer::EntityCommandBuffer()
+{
+}
+
+void EntityCommandBuffer::record(CommandType type, Entity* entity)
+{
+    Command command;
+    command.type = type;
+    command.entity = entity;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_commands.push_back(command);
+}
+
+void EntityCommandBuffer::takeCommands(vector<Command>& commands)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_commands.swap(commands);
+}
@@ -0,0 +1,51 @@
+#ifndef ENTITYCOMMANDBUFFER_H_INCLUDED
+#define ENTITYCOMMANDBUFFER_H_INCLUDED
+
+#include <vector>
+#include <mutex>
+
+#include "uncopyable.h"
+
+class Entity;
+
+/**
+    Changes to the set of entities in the world, recorded while a stage
+    of the update is running and carried out together once it has
+    finished. Nothing walking the world's entities ever sees them change
+    underneath it, and recording is safe from any number of threads.
+
+    Commands are kept in the order they were recorded.
+*/
+class EntityCommandBuffer : private Uncopyable
+{
+public:
+    enum CommandType
+    {
+        SPAWN,   //Add a new (or reused) entity to the world
+        DESTROY, //Take an entity out of the world
+        REVIVE   //Bring a dead ogro back as a new one
+    };
+
+    struct Command
+    {
+        CommandType type;
+        Entity* entity;
+    };
+
+    EntityCommandBuffer();
+
+    void record(CommandType type, Entity* entity);
+
+    /**
+        Swaps everything recorded so far into commands (which should be
+        empty) and starts recording again. Swapping lets both vectors keep
+        their memory, so recording rarely has to allocate.
+    */
+    void takeCommands(std::vector<Command>& commands);
+
+private:
+    std::vector<Command> m_commands;
+    std::mutex m_mutex;
+};
+
+#endif // ENTITYCOMMANDBUFFER_H_INCLUDED
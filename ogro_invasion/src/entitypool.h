@@ -0,0 +1,82 @@
+#ifndef ENTITYPOOL_H_INCLUDED
+#define ENTITYPOOL_H_INCLUDED
+
+#include <vector>
+#include <cassert>
+#include <cstddef>
+
+#include "uncopyable.h"
+
+/**
+    Entities of one type that are reused rather than created and deleted
+    each time one is spawned or removed. The pool owns every entity it has
+    been given, whether it's live or waiting to be reused, and deletes
+    them all when it's destroyed.
+
+    The free entities are a stack so acquiring and releasing are O(1) and
+    don't allocate, the most recently released one is handed out first.
+*/
+template <typename T>
+class EntityPool : private Uncopyable
+{
+public:
+    EntityPool():
+    m_liveCount(0)
+    {
+    }
+
+    ~EntityPool()
+    {
+        for (typename std::vector<T*>::iterator entity = m_entities.begin(); entity != m_entities.end(); ++entity)
+        {
+            delete (*entity);
+        }
+    }
+
+    //Takes ownership of a new entity, it's handed out straight away if it's live
+    void add(T* entity, bool live)
+    {
+        m_entities.push_back(entity);
+        m_free.reserve(m_entities.size()); //So release() never has to grow it
+
+        if (live)
+        {
+            ++m_liveCount;
+        }
+        else
+        {
+            m_free.push_back(entity);
+        }
+    }
+
+    //NULL when every entity is live
+    T* acquire()
+    {
+        if (m_free.empty())
+        {
+            return NULL;
+        }
+
+        T* entity = m_free.back();
+        m_free.pop_back();
+        ++m_liveCount;
+        return entity;
+    }
+
+    void release(T* entity)
+    {
+        assert(m_liveCount > 0);
+        m_free.push_back(entity);
+        --m_liveCount;
+    }
+
+    unsigned int getLiveCount() const { return m_liveCount; }
+    unsigned int getSize() const { return m_entities.size(); }
+
+private:
+    std::vector<T*> m_entities;
+    std::vector<T*> m_free;
+    unsigned int m_liveCount;
+};
+
+#endif // ENTITYPOOL_H_INCLUDED
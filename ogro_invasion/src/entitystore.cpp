@@ -0,0 +1,186 @@
+#include "entitystore.h"
+#include "entity.h"
+#include "collider.h"
+
+using std::vector;
+
+EntityStore::EntityStore()
+{
+}
+
+void EntityStore::add(Entity* entity)
+{
+    Collider* collider = entity->getCollider();
+
+    m_entities.push_back(entity);
+    m_colliders.push_back(collider);
+    m_types.push_back((unsigned char)entity->getType());
+    m_bounded.push_back((collider && collider->isBounded()) ? 1 : 0);
+    m_continuous.push_back((collider && collider->isContinuous()) ? 1 : 0);
+    m_static.push_back(entity->isStatic() ? 1 : 0);
+
+    //The entity's state moves in here until it's taken out again
+    m_x.push_back(entity->m_position.x);
+    m_y.push_back(entity->m_position.y);
+    m_z.push_back(entity->m_position.z);
+    m_previousX.push_back(entity->m_previousPosition.x);
+    m_previousY.push_back(entity->m_previousPosition.y);
+    m_previousZ.push_back(entity->m_previousPosition.z);
+    m_yaws.push_back(entity->m_yaw);
+    m_pitches.push_back(entity->m_pitch);
+    m_previousYaws.push_back(entity->m_previousYaw);
+    m_previousPitches.push_back(entity->m_previousPitch);
+    m_hasPreviousState.push_back(entity->m_hasPreviousState ? 1 : 0);
+    m_radii.push_back(entity->m_radius);
+    m_removable.push_back(entity->m_canBeRemoved ? 1 : 0);
+
+    entity->m_store = this;
+    entity->m_storeSlot = m_entities.size() - 1;
+}
+
+//Hands an entity its state back as it leaves the store, a pool may put it back in the world later
+void EntityStore::release(unsigned int i)
+{
+    Entity* entity = m_entities[i];
+    entity->m_position = getPosition(i);
+    entity->m_previousPosition = Vector3(m_previousX[i], m_previousY[i], m_previousZ[i]);
+    entity->m_yaw = m_yaws[i];
+    entity->m_pitch = m_pitches[i];
+    entity->m_previousYaw = m_previousYaws[i];
+    entity->m_previousPitch = m_previousPitches[i];
+    entity->m_hasPreviousState = (m_hasPreviousState[i] != 0);
+    entity->m_radius = m_radii[i];
+    entity->m_canBeRemoved = (m_removable[i] != 0);
+
+    entity->m_store = NULL;
+    entity->m_storeSlot = 0;
+}
+
+void EntityStore::removeDead()
+{
+    //Slide everything that's staying down over the gaps
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < m_entities.size(); ++i)
+    {
+        if (m_removable[i])
+        {
+            release(i);
+            continue;
+        }
+
+        if (kept != i)
+        {
+            m_entities[i]->m_storeSlot = kept;
+            m_entities[kept] = m_entities[i];
+            m_colliders[kept] = m_colliders[i];
+            m_types[kept] = m_types[i];
+            m_bounded[kept] = m_bounded[i];
+            m_continuous[kept] = m_continuous[i];
+            m_static[kept] = m_static[i];
+            m_x[kept] = m_x[i];
+            m_y[kept] = m_y[i];
+            m_z[kept] = m_z[i];
+            m_previousX[kept] = m_previousX[i];
+            m_previousY[kept] = m_previousY[i];
+            m_previousZ[kept] = m_previousZ[i];
+            m_yaws[kept] = m_yaws[i];
+            m_pitches[kept] = m_pitches[i];
+            m_previousYaws[kept] = m_previousYaws[i];
+            m_previousPitches[kept] = m_previousPitches[i];
+            m_hasPreviousState[kept] = m_hasPreviousState[i];
+            m_radii[kept] = m_radii[i];
+            m_removable[kept] = m_removable[i];
+        }
+        ++kept;
+    }
+
+    m_entities.resize(kept);
+    m_colliders.resize(kept);
+    m_types.resize(kept);
+    m_bounded.resize(kept);
+    m_continuous.resize(kept);
+    m_static.resize(kept);
+    m_x.resize(kept);
+    m_y.resize(kept);
+    m_z.resize(kept);
+    m_previousX.resize(kept);
+    m_previousY.resize(kept);
+    m_previousZ.resize(kept);
+    m_yaws.resize(kept);
+    m_pitches.resize(kept);
+    m_previousYaws.resize(kept);
+    m_previousPitches.resize(kept);
+    m_hasPreviousState.resize(kept);
+    m_radii.resize(kept);
+    m_removable.resize(kept);
+}
+
+void EntityStore::clear()
+{
+    for (unsigned int i = 0; i < m_entities.size(); ++i)
+    {
+        release(i);
+    }
+
+    m_entities.clear();
+    m_colliders.clear();
+    m_types.clear();
+    m_bounded.clear();
+    m_continuous.clear();
+    m_static.clear();
+    m_x.clear();
+    m_y.clear();
+    m_z.clear();
+    m_previousX.clear();
+    m_previousY.clear();
+    m_previousZ.clear();
+    m_yaws.clear();
+    m_pitches.clear();
+    m_previousYaws.clear();
+    m_previousPitches.clear();
+    m_hasPreviousState.clear();
+    m_radii.clear();
+    m_removable.clear();
+}
+
+void EntityStore::savePreviousState()
+{
+    //Straight copies from one array to another
+    m_previousX = m_x;
+    m_previousY = m_y;
+    m_previousZ = m_z;
+    m_previousYaws = m_yaws;
+    m_previousPitches = m_pitches;
+    m_hasPreviousState.assign(m_hasPreviousState.size(), 1);
+}
+
+unsigned int EntityStore::getCount(EntityType type) const
+{
+    unsigned int count = 0;
+    for (vector<unsigned char>::const_iterator it = m_types.begin(); it != m_types.end(); ++it)
+    {
+        if ((*it) == type)
+        {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+Vector3 EntityStore::getPreviousPosition(unsigned int i) const
+{
+    if (!m_hasPreviousState[i])
+    {
+        return getPosition(i);
+    }
+
+    return Vector3(m_previousX[i], m_previousY[i], m_previousZ[i]);
+}
+
+Vector3 EntityStore::getRenderPosition(unsigned int i, float interpolation) const
+{
+    Vector3 previous = getPreviousPosition(i);
+    Vector3 current = getPosition(i);
+    return previous + ((current - previous) * interpolation);
+}
@@ -0,0 +1,115 @@
+#ifndef ENTITYSTORE_H_INCLUDED
+#define ENTITYSTORE_H_INCLUDED
+
+#include <vector>
+
+#include "geom.h"
+#include "entitytypes.h"
+#include "uncopyable.h"
+
+class Entity;
+class Collider;
+
+/**
+    The entities in the world, stored as parallel arrays (one per field)
+    rather than a list of pointers. Slot i of every array belongs to the
+    same entity.
+
+    The type, collider and whether it is bounded, continuous or static never
+    change so they're filled in when an entity is added. The rest
+    (positions, orientation, collision radius, whether it can be removed)
+    lives here and nowhere else while the entity is in the world: each
+    entity knows its slot and its getters and setters read and write the
+    arrays. The loops over every entity, saving the state at the start of
+    a step, the collision broadphase and narrowphase, culling and
+    counting, read straight through a few arrays instead of calling into
+    each entity.
+
+    An entity that isn't in the store (waiting to be spawned, or back in
+    its pool) holds on to its own state. It's moved in by add() and handed
+    back when the entity is taken out.
+
+    Removing entities closes the gaps without changing the order of the
+    rest, so everything is still updated and collided in the order it was
+    spawned.
+*/
+class EntityStore : private Uncopyable
+{
+public:
+    EntityStore();
+
+    void add(Entity* entity);
+
+    //Takes out every entity that can be removed
+    void removeDead();
+    void clear();
+
+    //Remembers where everything is before a step, for rendering between steps and sweeping colliders
+    void savePreviousState();
+
+    unsigned int getCount() const { return m_entities.size(); }
+    unsigned int getCount(EntityType type) const;
+
+    Entity* getEntity(unsigned int i) const { return m_entities[i]; }
+    Collider* getCollider(unsigned int i) const { return m_colliders[i]; }
+    EntityType getType(unsigned int i) const { return (EntityType)m_types[i]; }
+    bool isBounded(unsigned int i) const { return m_bounded[i] != 0; }
+    bool isContinuous(unsigned int i) const { return m_continuous[i] != 0; }
+    bool isStatic(unsigned int i) const { return m_static[i] != 0; }
+
+    /**
+        Different slots can be written from different threads, which is
+        how the entities are prepared in parallel.
+    */
+    Vector3 getPosition(unsigned int i) const { return Vector3(m_x[i], m_y[i], m_z[i]); }
+    void setPosition(unsigned int i, const Vector3& position) { m_x[i] = position.x; m_y[i] = position.y; m_z[i] = position.z; }
+    float getYaw(unsigned int i) const { return m_yaws[i]; }
+    void setYaw(unsigned int i, float yaw) { m_yaws[i] = yaw; }
+    float getPitch(unsigned int i) const { return m_pitches[i]; }
+    void setPitch(unsigned int i, float pitch) { m_pitches[i] = pitch; }
+    float getRadius(unsigned int i) const { return m_radii[i]; }
+    void setRadius(unsigned int i, float radius) { m_radii[i] = radius; }
+    bool canBeRemoved(unsigned int i) const { return m_removable[i] != 0; }
+    void setCanBeRemoved(unsigned int i, bool removable) { m_removable[i] = removable ? 1 : 0; }
+
+    //Where the last step started from, or where it is now if it hasn't been stepped yet
+    void resetPreviousState(unsigned int i) { m_hasPreviousState[i] = 0; }
+    Vector3 getPreviousPosition(unsigned int i) const;
+    float getPreviousYaw(unsigned int i) const { return m_hasPreviousState[i] ? m_previousYaws[i] : m_yaws[i]; }
+    float getPreviousPitch(unsigned int i) const { return m_hasPreviousState[i] ? m_previousPitches[i] : m_pitches[i]; }
+
+    //Blends the position at the start of the last step with the current one, like Entity::getRenderPosition()
+    Vector3 getRenderPosition(unsigned int i, float interpolation) const;
+
+    //Whole arrays, for loops that work on several entities at once
+    const float* getXs() const { return m_x.empty() ? NULL : &m_x[0]; }
+    const float* getYs() const { return m_y.empty() ? NULL : &m_y[0]; }
+    const float* getZs() const { return m_z.empty() ? NULL : &m_z[0]; }
+    const float* getRadii() const { return m_radii.empty() ? NULL : &m_radii[0]; }
+
+private:
+    void release(unsigned int i);
+
+    std::vector<Entity*> m_entities;
+    std::vector<Collider*> m_colliders; //NULL if the entity doesn't collide
+    std::vector<unsigned char> m_types;
+    std::vector<unsigned char> m_bounded;
+    std::vector<unsigned char> m_continuous;
+    std::vector<unsigned char> m_static;
+
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_z;
+    std::vector<float> m_previousX;
+    std::vector<float> m_previousY;
+    std::vector<float> m_previousZ;
+    std::vector<float> m_yaws;
+    std::vector<float> m_pitches;
+    std::vector<float> m_previousYaws;
+    std::vector<float> m_previousPitches;
+    std::vector<unsigned char> m_hasPreviousState;
+    std::vector<float> m_radii;
+    std::vector<unsigned char> m_removable;
+};
+
+#endif // ENTITYSTORE_H_INCLUDED
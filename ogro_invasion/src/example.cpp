@@ -55,6 +55,19 @@ m_FPS(0.0f)
     m_world = std::auto_ptr<GameWorld>(new GameWorld(getWindow()->getKeyboard(), getWindow()->getMouse()));
 }
 
+Example::Example(BOGLGPWindow* window, KeyboardInterface* keyboard, MouseInterface* mouse):
+m_angle(0.0),
+m_font(NULL),
+m_world(NULL),
+m_window(window),
+m_FPS(0.0f)
+{
+    glGenVertexArrays(1, &m_VAO);
+    glBindVertexArray(m_VAO);
+
+    m_world = std::auto_ptr<GameWorld>(new GameWorld(keyboard, mouse));
+}
+
 Example::~Example()
 {
 }
@@ -72,6 +85,7 @@ bool Example::init()
     //We pass these into our font so the ortho mode can set the resolution for the window
     GLint viewport[4];
     glGetIntegerv(GL_VIEWPORT, viewport);
+    m_world->setViewport(viewport[2], viewport[3]);
   
     //Get the correct font shader depending on the support GL version
     std::string fontVert = getShaderPath(GL2_FONT_VERT_SHADER, GL3_FONT_VERT_SHADER);
@@ -89,7 +103,6 @@ bool Example::init()
         return false;
     }
 
-    srand(time(0));
     return true;
 }
 
@@ -97,24 +110,37 @@ bool Example::init()
 void Example::prepare(float dt)
 {
     m_world->update(dt);
-    updateFPS(dt);
 }
 
 
-void Example::render()
+void Example::render(float interpolation)
+{
+    renderScene(interpolation);
+    renderHUD();
+}
+
+void Example::renderScene(float interpolation)
 {
+    m_world->setRenderInterpolation(interpolation);
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     //Load the identity matrix (reset to the default position and orientation)
     glLoadIdentity();
 
+    if (m_world->getRemainingTime() > 0.0f)
+    {
+        m_world->render();
+    }
+}
+
+void Example::renderHUD()
+{
     //Draw the crosshair:
     GLint viewport[4];
     glGetIntegerv(GL_VIEWPORT, viewport);
 
     if (m_world->getRemainingTime() > 0.0f)
     {
-        m_world->render();
-
         //Print out the player's score
         stringstream scoreString;
         scoreString << "Score: " << m_world->getPlayer()->getScore();
@@ -152,6 +178,7 @@ void Example::shutdown()
 void Example::onResize(int width, int height)
 {
     glViewport(0, 0, width, height);
+    m_world->setViewport(width, height);
 
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
@@ -7,21 +7,28 @@
 class FreeTypeFont;
 class GameWorld;
 class BOGLGPWindow;
+class KeyboardInterface;
+class MouseInterface;
 
 class Example : private Uncopyable
 {
 public:
     Example(BOGLGPWindow* window);
+    //Drives the game from something other than the window's keyboard and mouse
+    Example(BOGLGPWindow* window, KeyboardInterface* keyboard, MouseInterface* mouse);
     virtual ~Example();
 
     bool init();
     void prepare(float dt);
-    void render();
+    void render(float interpolation);
+    void renderScene(float interpolation);
+    void renderHUD();
     void shutdown();
     void onResize(int width, int height);
 
     BOGLGPWindow* getWindow() { return m_window; }
     void setWindow(BOGLGPWindow* window) { m_window = window; }
+    GameWorld* getWorld() { return m_world.get(); }
 
     void updateFPS(float dt);
 private:
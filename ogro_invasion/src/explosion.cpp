@@ -8,6 +8,7 @@
 
 #include "explosion.h"
 #include "glslshader.h"
+#include "gameworld.h"
 
 using std::vector;
 using std::string;
@@ -39,31 +40,10 @@ Explosion::~Explosion()
 
 bool Explosion::onInitialize()
 {
-    vector<Color> colors;
-    colors.push_back(Color(1.0f, 0.0f, 0.0f, 1.0f));
-    colors.push_back(Color(1.0f, 1.0f, 0.0f, 1.0f));
-    colors.push_back(Color(1.0f, 0.5f, 0.0f, 1.0f));
-    colors.push_back(Color(0.5f, 0.5f, 0.5f, 1.0f));
+    resetParticles();
 
-    for (ParticleIterator it = m_particles.begin(); it != m_particles.end(); ++it)
-    {
-        float randX = rand() / ((float)RAND_MAX + 1) - 0.5f;
-        float randY = rand() / ((float)RAND_MAX + 1) - 0.5f;
-        float randZ = rand() / ((float)RAND_MAX + 1) - 0.5f;
-        float randSpeed = 1.5f; //(rand() / ((double)RAND_MAX + 1)) * 2.0f;
-
-        (*it).life = 1.0f;
-        (*it).velocity = Vector3(randX, randY, randZ);
-        (*it).velocity.normalize();
-        (*it).velocity = (*it).velocity * randSpeed;
-
-        (*it).position = getPosition(); //Set to the same starting point
-
-        int randColor = rand() % colors.size();
-        (*it).color = colors[randColor];
-    }
-
-    if (m_particleTexID == 0)
+    //The particles still move when headless, they just don't get drawn
+    if (m_particleTexID == 0 && !getWorld()->isHeadless())
     {
         const string vertexShader = (GLSLProgram::glsl130Supported()) ? VERTEX_SHADER_130 : VERTEX_SHADER_120;
         const string fragmentShader = (GLSLProgram::glsl130Supported()) ? FRAGMENT_SHADER_130 : FRAGMENT_SHADER_120;
@@ -107,6 +87,52 @@ bool Explosion::onInitialize()
     return true;
 }
 
+void Explosion::onRespawn()
+{
+    resetParticles();
+}
+
+//The particles all start off from wherever the explosion is put
+void Explosion::onMove()
+{
+    const Vector3 position = getPosition();
+    for (ParticleIterator it = m_particles.begin(); it != m_particles.end(); ++it)
+    {
+        (*it).position = position;
+    }
+}
+
+//Sends every particle off from the middle again in a random direction
+void Explosion::resetParticles()
+{
+    static const Color colors[] =
+    {
+        Color(1.0f, 0.0f, 0.0f, 1.0f),
+        Color(1.0f, 1.0f, 0.0f, 1.0f),
+        Color(1.0f, 0.5f, 0.0f, 1.0f),
+        Color(0.5f, 0.5f, 0.5f, 1.0f)
+    };
+    const int colorCount = sizeof(colors) / sizeof(colors[0]);
+
+    for (ParticleIterator it = m_particles.begin(); it != m_particles.end(); ++it)
+    {
+        float randX = rand() / ((float)RAND_MAX + 1) - 0.5f;
+        float randY = rand() / ((float)RAND_MAX + 1) - 0.5f;
+        float randZ = rand() / ((float)RAND_MAX + 1) - 0.5f;
+        float randSpeed = 1.5f; //(rand() / ((double)RAND_MAX + 1)) * 2.0f;
+
+        (*it).life = 1.0f;
+        (*it).velocity = Vector3(randX, randY, randZ);
+        (*it).velocity.normalize();
+        (*it).velocity = (*it).velocity * randSpeed;
+
+        (*it).position = getPosition(); //Set to the same starting point
+
+        int randColor = rand() % colorCount;
+        (*it).color = colors[randColor];
+    }
+}
+
 void Explosion::onPrepare(float dT)
 {
     int numDead = 0;
@@ -28,21 +28,6 @@ public:
     typedef std::vector<Particle>::iterator ParticleIterator;
     typedef std::vector<Particle>::const_iterator ConstParticleIterator;
 
-    Vector3 getPosition() const { return m_position; }
-    void setPosition(const Vector3& v)
-    {
-        m_position = v;
-        for (ParticleIterator it = m_particles.begin(); it != m_particles.end(); ++it)
-        {
-            (*it).position = m_position;
-        }
-    }
-
-    float getYaw() const { return 0.0f; }
-    float getPitch() const { return 0.0f; }
-    void setYaw(const float v) { }
-    void setPitch(const float v) { }
-
     Collider* getCollider() { return NULL; }
 
     EntityType getType() const { return EXPLOSION; }
@@ -53,6 +38,10 @@ private:
     bool onInitialize();
     void onCollision(Entity* collider) {}
     void onShutdown();
+    void onRespawn();
+    void onMove();
+
+    void resetParticles();
 
     std::vector<Particle> m_particles;
 
@@ -62,8 +51,6 @@ private:
 
     static TargaImage m_particleTexture;
     static GLuint m_particleTexID;
-
-    Vector3 m_position;
 };
 
 
@@ -1,4 +1,5 @@
 #include "freetypefont.h"
+#include "profiler.h"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -158,6 +159,8 @@ bool FreeTypeFont::generateCharacterTexture(unsigned char ch, FT_Face fontInfo)
 
 void FreeTypeFont::printString(const std::string& str, float x, float y)
 {
+    PROFILE_ZONE("FreeTypeFont::printString");
+
     static float modelviewMatrix[16];
     static float projectionMatrix[16];
 
@@ -47,6 +47,40 @@ bool Frustum::PointInFrustum( float x, float y, float z )
 	return true;
 }
 
+/**
+    For each plane only two corners of the box matter, the one furthest
+    along the plane's normal and the one furthest against it. If the
+    furthest corner is behind a plane so is the whole box, if the nearest
+    corner is behind one the box crosses the edge of the frustum.
+*/
+Frustum::BoxResult Frustum::boxInFrustum(float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+{
+    BoxResult result = BOX_INSIDE;
+	for (int p = 0; p < 6; p++)
+    {
+        const Plane& plane = m_planes[p];
+
+        float furthest = plane.a * (plane.a > 0.0f ? maxX : minX) +
+                         plane.b * (plane.b > 0.0f ? maxY : minY) +
+                         plane.c * (plane.c > 0.0f ? maxZ : minZ) +
+                         plane.d;
+        if (furthest < 0.0f)
+        {
+            return BOX_OUTSIDE;
+        }
+
+        float nearest = plane.a * (plane.a > 0.0f ? minX : maxX) +
+                        plane.b * (plane.b > 0.0f ? minY : maxY) +
+                        plane.c * (plane.c > 0.0f ? minZ : maxZ) +
+                        plane.d;
+        if (nearest < 0.0f)
+        {
+            result = BOX_INTERSECTS;
+        }
+    }
+	return result;
+}
+
 void Frustum::updateFrustum(float modelMatrix[])
 {
     GLfloat projection[16];
@@ -11,6 +11,15 @@ public:
 	bool sphereInFrustum(float x, float y, float z, float radius);
 	bool PointInFrustum(float x, float y, float z);
 
+    enum BoxResult {
+        BOX_OUTSIDE = 0,
+        BOX_INTERSECTS,
+        BOX_INSIDE
+    };
+
+    //Whether an axis aligned box is outside, partly inside or wholly inside the frustum
+    BoxResult boxInFrustum(float minX, float minY, float minZ, float maxX, float maxY, float maxZ);
+
 private:
 	Plane m_planes[6];
 
@@ -5,7 +5,6 @@
 #include <ctime>
 #include <stdexcept>
 #include <cassert>
-#include <algorithm>
 
 #include "gameworld.h"
 #include "ogro.h"
@@ -20,6 +19,13 @@
 #include "explosion.h"
 #include "tree.h"
 #include "frustum.h"
+#include "collisiongrid.h"
+#include "assetmanager.h"
+#include "md2batch.h"
+#include "md2model.h"
+#include "timer.h"
+#include "jobsystem.h"
+#include "profiler.h"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -31,9 +37,9 @@ using std::list;
 using std::string;
 const std::string TERRAIN_HEIGHTMAP = "data/island.raw";
 
-GameWorld::GameWorld(KeyboardInterface* keyboardInterface, MouseInterface* mouseInterface):
-m_entities(list<Entity*>()),
-m_colliders(list<Collider*>()),
+const float GameWorld::COLLISION_CELL_SIZE = 4.0f;
+
+GameWorld::GameWorld(KeyboardInterface* keyboardInterface, MouseInterface* mouseInterface, bool headless):
 m_player(NULL),
 m_landscape(NULL),
 m_gameCamera(NULL),
@@ -42,26 +48,45 @@ m_mouse(mouseInterface),
 m_lastSpawn(0),
 m_currentTime(0),
 m_relX(0),
-m_relY(0)
+m_relY(0),
+m_renderInterpolation(1.0f),
+m_headless(headless),
+m_viewportWidth(0),
+m_viewportHeight(0),
+m_randomSeed((unsigned int)time(0)),
+m_terrainDisplaced(false),
+m_lastCollisionTime(0.0),
+m_collisionGrid(NULL)
 {
     m_gameCamera = std::auto_ptr<Camera>(new Camera());
     m_frustum = std::auto_ptr<Frustum>(new Frustum());
+    m_assets = std::auto_ptr<AssetManager>(new AssetManager(headless));
+    m_jobs = std::auto_ptr<JobSystem>(new JobSystem());
 }
 
 GameWorld::~GameWorld()
 {
 
-    //Free any allocated memory
-    for (list<Entity*>::iterator entity = m_entities.begin();
-         entity != m_entities.end(); ++entity)
+    applyCommands(); //So nothing still waiting to be added is missed
+
+    //Free any allocated memory, the pools delete their own
+    std::vector<Entity*> unpooled;
+    for (unsigned int i = 0; i < m_entities.getCount(); ++i)
     {
-        delete (*entity);
-        (*entity) = NULL;
+        EntityType type = m_entities.getType(i);
+        if (type != OGRO && type != ROCKET && type != EXPLOSION)
+        {
+            unpooled.push_back(m_entities.getEntity(i));
+        }
     }
 
-    //Clear the entities and colliders
+    //Everything gets its state back before it is deleted
     m_entities.clear();
-    m_colliders.clear();
+
+    for (std::vector<Entity*>::iterator entity = unpooled.begin(); entity != unpooled.end(); ++entity)
+    {
+        delete (*entity);
+    }
 }
 
 /**
@@ -75,10 +100,7 @@ GameWorld::~GameWorld()
     template <typename T>
     Entity* spawnEntity() {
         Entity* newEntity = new T();
-        if (newEntity->getCollider())
-            registerCollider(newEntity->getCollider());
-        }
-        registerEntity(newEntity);
+        m_entities.add(newEntity);
 
         return newEntity;
     }
@@ -90,24 +112,75 @@ GameWorld::~GameWorld()
 */
 Entity* GameWorld::spawnEntity(EntityType entityType)
 {
+    //Entities can be spawned from several threads at once during update
+    std::lock_guard<std::mutex> lock(m_spawnMutex);
+
     Entity* newEntity = NULL;
-    bool initialize = true;
     switch(entityType)
     {
         case OGRO:
-            //In the case of the ogro, we can reuse old dead ones
-            newEntity = findDeadEnemy();
+        {
+            m_lastSpawn = m_currentTime;
+
+            //In the case of the ogro, we can reuse old dead ones. They never
+            //left the world so they only need to get back up.
+            Ogro* ogro = m_ogroPool.acquire();
+            if (ogro)
+            {
+                m_commands.record(EntityCommandBuffer::REVIVE, ogro);
+                return ogro;
+            }
+
+            newEntity = createEntity(OGRO);
+            m_ogroPool.add(static_cast<Ogro*>(newEntity), true);
+        }
+        break;
+        case ROCKET:
+            newEntity = m_rocketPool.acquire();
             if (newEntity)
             {
-                (dynamic_cast<Enemy*>(newEntity))->bringToLife();
-                initialize = false;
+                newEntity->respawn();
             }
             else
             {
-                newEntity = new Ogro(this);
+                newEntity = createEntity(ROCKET);
+                m_rocketPool.add(static_cast<Rocket*>(newEntity), true);
             }
+        break;
+        case EXPLOSION:
+            newEntity = m_explosionPool.acquire();
+            if (newEntity)
+            {
+                newEntity->respawn();
+            }
+            else
+            {
+                newEntity = createEntity(EXPLOSION);
+                m_explosionPool.add(static_cast<Explosion*>(newEntity), true);
+            }
+        break;
+        default:
+            newEntity = createEntity(entityType);
+    }
 
-            m_lastSpawn = m_currentTime;
+    m_commands.record(EntityCommandBuffer::SPAWN, newEntity);
+
+    return newEntity;
+}
+
+void GameWorld::destroyEntity(Entity* entity)
+{
+    m_commands.record(EntityCommandBuffer::DESTROY, entity);
+}
+
+//Makes and initializes a brand new entity, spawnEntity() decides whether one is needed
+Entity* GameWorld::createEntity(EntityType entityType)
+{
+    Entity* newEntity = NULL;
+    switch(entityType)
+    {
+        case OGRO:
+            newEntity = new Ogro(this);
         break;
         case PLAYER:
             if (m_player)
@@ -123,12 +196,18 @@ Entity* GameWorld::spawnEntity(EntityType entityType)
             {
                 throw std::invalid_argument("Attempted to spawn a second landscape");
             }
-            //If GLSL 1.30 is supported use that shader, otherwise use the glsl1.20 shader
-            string vertexShader = (GLSLProgram::glsl130Supported()) ? "data/shaders/glsl1.30/terrain.vert" : "data/shaders/glsl1.20/terrain.vert";
-            string fragShader = (GLSLProgram::glsl130Supported()) ? "data/shaders/glsl1.30/terrain.frag" : "data/shaders/glsl1.20/terrain.frag";
+            string vertexShader, fragShader, waterVert, waterFrag;
+
+            //Without a context there's nobody to ask, and the shaders are never built anyway
+            if (!m_headless)
+            {
+                //If GLSL 1.30 is supported use that shader, otherwise use the glsl1.20 shader
+                vertexShader = (GLSLProgram::glsl130Supported()) ? "data/shaders/glsl1.30/terrain.vert" : "data/shaders/glsl1.20/terrain.vert";
+                fragShader = (GLSLProgram::glsl130Supported()) ? "data/shaders/glsl1.30/terrain.frag" : "data/shaders/glsl1.20/terrain.frag";
 
-            string waterVert = (GLSLProgram::glsl130Supported()) ? "data/shaders/glsl1.30/water.vert" : "data/shaders/glsl1.20/water.vert";
-            string waterFrag = (GLSLProgram::glsl130Supported()) ? "data/shaders/glsl1.30/water.frag" : "data/shaders/glsl1.20/water.frag";
+                waterVert = (GLSLProgram::glsl130Supported()) ? "data/shaders/glsl1.30/water.vert" : "data/shaders/glsl1.20/water.vert";
+                waterFrag = (GLSLProgram::glsl130Supported()) ? "data/shaders/glsl1.30/water.frag" : "data/shaders/glsl1.20/water.frag";
+            }
             newEntity = new Landscape(this, TERRAIN_HEIGHTMAP, vertexShader, fragShader, waterVert, waterFrag);
             m_landscape = dynamic_cast<Landscape*>(newEntity);
         }
@@ -137,7 +216,7 @@ Entity* GameWorld::spawnEntity(EntityType entityType)
             newEntity = new Rocket(this);
         break;
         case EXPLOSION:
-            newEntity = new Explosion(this, 250);
+            newEntity = new Explosion(this, EXPLOSION_PARTICLE_COUNT);
         break;
         case TREE:
             newEntity = new Tree(this);
@@ -146,29 +225,153 @@ Entity* GameWorld::spawnEntity(EntityType entityType)
             throw std::invalid_argument("Attempted to spawn an invalid entity");
     }
 
-    if (initialize && !newEntity->initialize())
+    if (!newEntity->initialize())
     {
         delete newEntity;
         throw std::runtime_error("Could not initialize one of the entities");
     }
 
-    //If this entity has a collider (i.e. responds to physics) then
-    //register it as such
-    if (newEntity->getCollider())
+    return newEntity;
+}
+
+/**
+    Makes the rockets and explosions up front, so firing doesn't have to
+    allocate or load anything until more are flying than the pools hold
+*/
+void GameWorld::fillPools()
+{
+    for (int i = 0; i < ROCKET_POOL_SIZE; ++i)
     {
-        registerCollider(newEntity->getCollider());
+        m_rocketPool.add(static_cast<Rocket*>(createEntity(ROCKET)), false);
     }
 
-    registerEntity(newEntity);
+    for (int i = 0; i < EXPLOSION_POOL_SIZE; ++i)
+    {
+        m_explosionPool.add(static_cast<Explosion*>(createEntity(EXPLOSION)), false);
+    }
+}
 
-    return newEntity;
+void GameWorld::releaseOgro(Ogro* ogro)
+{
+    std::lock_guard<std::mutex> lock(m_spawnMutex);
+    m_ogroPool.release(ogro);
+}
+
+/**
+    Carries out everything recorded since the last time this was called.
+    Only called between the stages of update() (or during initialize()) so
+    nothing else is running. The dead are all taken out in one pass after
+    the rest, so something spawned and destroyed in the same stage is
+    still handled.
+*/
+void GameWorld::applyCommands()
+{
+    PROFILE_ZONE("GameWorld::applyCommands");
+
+    m_appliedCommands.clear();
+    m_commands.takeCommands(m_appliedCommands);
+
+    bool anyDestroyed = false;
+    bool staticsChanged = false;
+    for (std::vector<EntityCommandBuffer::Command>::iterator command = m_appliedCommands.begin();
+         command != m_appliedCommands.end(); ++command)
+    {
+        switch ((*command).type)
+        {
+            case EntityCommandBuffer::SPAWN:
+                m_entities.add((*command).entity);
+                staticsChanged = staticsChanged || (*command).entity->isStatic();
+            break;
+            case EntityCommandBuffer::DESTROY:
+                anyDestroyed = true;
+                staticsChanged = staticsChanged || (*command).entity->isStatic();
+            break;
+            case EntityCommandBuffer::REVIVE:
+            {
+                //The body never left the world so it only needs to get back up
+                Ogro* ogro = static_cast<Ogro*>((*command).entity);
+                ogro->bringToLife();
+                ogro->resetInterpolation(); //It has been moved somewhere else
+            }
+            break;
+        }
+    }
+
+    if (anyDestroyed)
+    {
+        m_entities.removeDead();
+    }
+
+    //Static entities are placed when they're spawned so this is rare, the
+    //trees are all put in together while the world is being set up
+    if (staticsChanged)
+    {
+        m_statics.build(m_entities);
+    }
+
+    if (!anyDestroyed)
+    {
+        return;
+    }
+
+    for (std::vector<EntityCommandBuffer::Command>::iterator command = m_appliedCommands.begin();
+         command != m_appliedCommands.end(); ++command)
+    {
+        if ((*command).type == EntityCommandBuffer::DESTROY)
+        {
+            removeEntity((*command).entity);
+        }
+    }
+}
+
+void GameWorld::prepareEntities(float dT)
+{
+    PROFILE_ZONE("GameWorld::prepareEntities");
+
+    m_entities.savePreviousState();
+
+    //The serial entities go first, the others may depend on what they do.
+    //They all write their own slot in the store, so they can't get in each
+    //other's way.
+    m_parallelEntities.clear();
+    for (unsigned int i = 0; i < m_entities.getCount(); ++i)
+    {
+        Entity* entity = m_entities.getEntity(i);
+        if (entity->canPrepareInParallel())
+        {
+            m_parallelEntities.push_back(entity);
+        }
+        else
+        {
+            entity->prepare(dT);
+        }
+    }
+
+    std::vector<Entity*>& entities = m_parallelEntities;
+    m_jobs->parallelFor(entities.size(), ENTITY_UPDATE_CHUNK_SIZE,
+        [&entities, dT](unsigned int begin, unsigned int end)
+        {
+            PROFILE_ZONE("GameWorld::prepareEntities chunk");
+            for (unsigned int i = begin; i < end; ++i)
+            {
+                entities[i]->prepare(dT);
+            }
+        });
 }
 
 bool GameWorld::initialize()
 {
-    srand((unsigned int)time(0));
+    srand(m_randomSeed);
 
     spawnEntity(LANDSCAPE); //Spawn the landscape
+    fillPools();
+
+    //The collision grid covers the terrain, anything that wanders off the edge
+    //is just clamped into the border cells
+    Terrain* terrain = getLandscape()->getTerrain();
+    m_collisionGrid = std::auto_ptr<CollisionGrid>(new CollisionGrid(terrain->getMinX(), terrain->getMaxX(),
+                                                                     terrain->getMinZ(), terrain->getMaxZ(),
+                                                                     COLLISION_CELL_SIZE));
 
     //Spawn a load of monsters
     for (int i = 0; i < MAX_ENEMY_COUNT; ++i)
@@ -176,6 +379,19 @@ bool GameWorld::initialize()
         Entity* newEntity = spawnEntity(OGRO);
         newEntity->setPosition(getRandomPosition());
     }
+    applyCommands();
+
+    //If we can, draw all the ogros in one go. They all share the same mesh
+    //and texture so any one of them will do to set up the batch.
+    if (!m_headless && MD2Batch::isSupported())
+    {
+        Ogro* ogro = dynamic_cast<Ogro*>(findFirstEntity(OGRO));
+        m_ogroBatch = std::auto_ptr<MD2Batch>(new MD2Batch(getAssets(), ogro->getModel()->getMesh(), ogro->getTextureID()));
+        if (!m_ogroBatch->initialize())
+        {
+            m_ogroBatch.reset();
+        }
+    }
 
     for (int i = 0; i < TREE_COUNT; ++i)
     {
@@ -186,6 +402,8 @@ bool GameWorld::initialize()
             pos = getRandomPosition();
         }
 
+        //Trees don't collide with the terrain, so they have to be stood on it here
+        pos.y += newEntity->getCollider()->getRadius();
         newEntity->setPosition(pos);
     }
 
@@ -195,28 +413,35 @@ bool GameWorld::initialize()
     m_gameCamera->attachTo(getPlayer()); //Attach the camera to the player
 
     m_remainingTime = 60.0f * 5; //5 minutes
+    applyCommands();
 
     return true;
 }
 
 void GameWorld::update(float dT)
 {
+    PROFILE_ZONE("GameWorld::update");
+
     m_currentTime += dT; //Update the time since we started
     m_remainingTime -= dT;
 
-    for (EntityIterator entity = m_entities.begin(); entity != m_entities.end(); ++entity)
-    {
-        (*entity)->prepare(dT);
-    }
+    //m_entities never changes while it's being walked, rockets fired,
+    //explosions set off and anything destroyed are held back as commands
+    //until the end of each stage
+    prepareEntities(dT); //Returns once every entity has been prepared
+    applyCommands();
 
     //Perform all the collisions
-    Collider::updateColliders(m_colliders);
-    clearDeadEntities(); //Remove any entities that were killed as a result of a collision
+    Timer collisionTimer;
+    Collider::updateColliders(m_entities, m_statics, *m_collisionGrid, m_narrowphase);
+    applyCommands(); //Remove any entities that were killed as a result of a collision
+    m_lastCollisionTime = collisionTimer.getElapsedSeconds();
 
     //Spawn an entity every 10 seconds if we have room
     if (getOgroCount() < MAX_ENEMY_COUNT && (m_currentTime - m_lastSpawn) > 10.0f)
     {
         spawnEntity(OGRO)->setPosition(getRandomPosition());
+        applyCommands();
     }
 
     /*
@@ -233,11 +458,9 @@ void GameWorld::update(float dT)
     int x, y;
     m_mouse->getMousePos(x, y);
     m_mouse->showCursor(false);
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
 
     //Add the current mouse position - starting position
-    mousePositionHistory.push_front(std::make_pair((float)x - (viewport[2] / 2), (float)y - (viewport[3] / 2)));
+    mousePositionHistory.push_front(std::make_pair((float)x - (m_viewportWidth / 2), (float)y - (m_viewportHeight / 2)));
     if (mousePositionHistory.size() > 10)
     {
         //Make sure only the last 10 positions are stored
@@ -265,13 +488,20 @@ void GameWorld::update(float dT)
     //m_relY = y - (viewport[3] / 2);
 
     //Put the mouse in the middle of the screen
-   m_mouse->setMousePos(viewport[2] / 2, viewport[3] / 2);
+   m_mouse->setMousePos(m_viewportWidth / 2, m_viewportHeight / 2);
 
 }
 
 
 void GameWorld::render() const
 {
+    PROFILE_ZONE("GameWorld::render");
+
+    if (m_headless)
+    {
+        return;
+    }
+
     m_gameCamera->apply();
     float project[16] = {1.53,0,0,0,0,2.05,0,0,0,0,-1.004,-1,0,0,-.2,0};
     float mvp[16] = {0.0};
@@ -291,82 +521,100 @@ void GameWorld::render() const
     
     m_frustum->updateFrustum(mvp);
 
-    for (ConstEntityIterator entity = m_entities.begin(); entity != m_entities.end(); ++entity)
+    if (m_ogroBatch.get())
     {
-        Vector3 pos = (*entity)->getPosition();
-        if ((*entity)->getType() == LANDSCAPE || (*entity)->getCollider() == NULL)
+        m_ogroBatch->clear();
+    }
+
+    for (unsigned int i = 0; i < m_entities.getCount(); ++i)
+    {
+        //Drawn below, once the hierarchy has culled them
+        if (m_entities.isStatic(i))
         {
-            (*entity)->SetMVP(m_gameCamera->GetMVPMatrix());
-            (*entity)->render();
-            (*entity)->postRender();
+            continue;
         }
-        else if (m_frustum->sphereInFrustum(pos.x, pos.y, pos.z, (*entity)->getCollider()->getRadius()))
+
+        Entity* entity = m_entities.getEntity(i);
+        EntityType type = m_entities.getType(i);
+        if (type == LANDSCAPE || m_entities.getCollider(i) == NULL)
         {
-            (*entity)->SetMVP(m_gameCamera->GetMVPMatrix());
-            (*entity)->render();
-            (*entity)->postRender();
+            entity->SetMVP(m_gameCamera->GetMVPMatrix());
+            entity->render();
+            entity->postRender();
+            continue;
         }
-    }
-}
 
-Vector3 GameWorld::getRandomPosition() const
-{
-    float minX = getLandscape()->getTerrain()->getMinX();
-    float mapWidth = getLandscape()->getTerrain()->getMaxX() - minX;
-
-    float randX = minX + ((rand() / ((float)RAND_MAX + 1)) * mapWidth);
-    float randZ = minX + ((rand() / ((float)RAND_MAX + 1)) * mapWidth);
-    float y = getLandscape()->getTerrain()->getHeightAt(randX, randZ);
-
-    return Vector3(randX, y, randZ);
-}
+        Vector3 pos = m_entities.getRenderPosition(i, m_renderInterpolation);
+        if (!m_frustum->sphereInFrustum(pos.x, pos.y, pos.z, m_entities.getRadius(i)))
+        {
+            continue;
+        }
 
-void GameWorld::clearDeadEntities()
-{
-    for (EntityIterator entity = m_entities.begin(); entity != m_entities.end();)
-    {
-        if (!(*entity)->canBeRemoved())
+        if (type == OGRO && m_ogroBatch.get())
         {
-            ++entity;
+            //Queue it up, all the ogros are drawn together below
+            const Ogro* ogro = static_cast<const Ogro*>(entity);
+            m_ogroBatch->addInstance(pos, ogro->getRenderYaw(), *ogro->getModel());
             continue;
         }
 
-        unregisterCollider((*entity)->getCollider());
-        delete (*entity);
-        entity = m_entities.erase(entity);
+        entity->SetMVP(m_gameCamera->GetMVPMatrix());
+        entity->render();
+        entity->postRender();
     }
-}
 
-void GameWorld::unregisterCollider(const Collider* collider)
-{
-    if (collider == NULL) {
-        return;
+    m_visibleStatics.clear();
+    m_statics.findVisible(*m_frustum, m_visibleStatics);
+    for (std::vector<Entity*>::const_iterator entity = m_visibleStatics.begin(); entity != m_visibleStatics.end(); ++entity)
+    {
+        (*entity)->SetMVP(m_gameCamera->GetMVPMatrix());
+        (*entity)->render();
+        (*entity)->postRender();
     }
 
-    for(ColliderIterator it = m_colliders.begin(); it != m_colliders.end(); ++it)
+    if (m_ogroBatch.get())
     {
-        if (collider == (*it)) {
-            m_colliders.erase(it);
-            break;
-        }
+        m_ogroBatch->render(m_gameCamera->GetMVPMatrix());
     }
 }
 
-void GameWorld::registerCollider(Collider* collider)
+Entity* GameWorld::findFirstEntity(EntityType type)
 {
-    if (std::find(m_colliders.begin(), m_colliders.end(), collider) != m_colliders.end())
+    for (unsigned int i = 0; i < m_entities.getCount(); ++i)
     {
-        return;
+        if (m_entities.getType(i) == type)
+        {
+            return m_entities.getEntity(i);
+        }
     }
 
-    m_colliders.push_back(collider);
+    return NULL;
 }
 
-void GameWorld::registerEntity(Entity* entity)
+Vector3 GameWorld::getRandomPosition() const
 {
-    if (std::find(m_entities.begin(), m_entities.end(), entity) != m_entities.end())
+    float minX = getLandscape()->getTerrain()->getMinX();
+    float mapWidth = getLandscape()->getTerrain()->getMaxX() - minX;
+
+    float randX = minX + ((rand() / ((float)RAND_MAX + 1)) * mapWidth);
+    float randZ = minX + ((rand() / ((float)RAND_MAX + 1)) * mapWidth);
+    float y = getLandscape()->getTerrain()->getHeightAt(randX, randZ);
+
+    return Vector3(randX, y, randZ);
+}
+
+//Hands pooled entities back to their pool to be reused, anything else is deleted
+void GameWorld::removeEntity(Entity* entity)
+{
+    switch (entity->getType())
     {
-        return;
+        case ROCKET:
+            m_rocketPool.release(static_cast<Rocket*>(entity));
+        break;
+        case EXPLOSION:
+            m_explosionPool.release(static_cast<Explosion*>(entity));
+        break;
+        default:
+            delete entity;
     }
-    m_entities.push_back(entity);
 }
@@ -6,9 +6,16 @@
 #include <string>
 #include <sstream>
 #include <memory>
+#include <vector>
+#include <mutex>
 
 #include "uncopyable.h"
 #include "enemy.h"
+#include "entitypool.h"
+#include "entitystore.h"
+#include "entitycommandbuffer.h"
+#include "narrowphase.h"
+#include "staticbvh.h"
 
 class KeyboardInterface;
 class MouseInterface;
@@ -17,65 +24,74 @@ class Camera;
 class Player;
 class Landscape;
 class Frustum;
+class CollisionGrid;
+class AssetManager;
+class MD2Batch;
+class JobSystem;
+class Ogro;
+class Rocket;
+class Explosion;
 
 class GameWorld : private Uncopyable
 {
     public:
-        /** Default constructor */
-        GameWorld(KeyboardInterface* keyboardInterface, MouseInterface* mouseInterface);
+        /**
+            A headless world never touches OpenGL, assets are only loaded
+            into system memory and render() does nothing. Used for running
+            the simulation on machines without a GPU.
+        */
+        GameWorld(KeyboardInterface* keyboardInterface, MouseInterface* mouseInterface, bool headless = false);
         /** Default destructor */
         virtual ~GameWorld();
 
+        /**
+            Creates and initializes a new entity (or reuses a pooled one).
+            The entity isn't added to the world until the current stage has
+            finished (so it's safe to call from onPrepare and onCollision),
+            until then it isn't updated, collided with or rendered. Set it
+            up straight away, before the stage ends.
+        */
         Entity* spawnEntity(EntityType entity);
 
+        //Called by Entity::destroy(), the entity is taken out at the end of the current stage
+        void destroyEntity(Entity* entity);
+
         bool initialize();
         void update(float dt);
         void render() const;
 
-        typedef std::list<Entity*>::iterator EntityIterator;
-        typedef std::list<Entity*>::const_iterator ConstEntityIterator;
-
-        typedef std::list<Collider*>::iterator ColliderIterator;
-        typedef std::list<Collider*>::const_iterator ConstColliderIterator;
-
         Player* getPlayer() { return m_player; }
         Landscape* getLandscape() const { return m_landscape; }
 
         KeyboardInterface* getKeyboard() { return m_keyboard; }
         MouseInterface* getMouse() { return m_mouse; }
+        AssetManager* getAssets() { return m_assets.get(); }
+        JobSystem* getJobSystem() { return m_jobs.get(); }
+        bool isHeadless() const { return m_headless; }
 
-        unsigned int getOgroCount()
-        {
-            unsigned int count = 0;
-            for (EntityIterator it = m_entities.begin(); it != m_entities.end(); ++it)
-            {
-                if ((*it)->getType() == OGRO) {
-                    if (!(dynamic_cast<Enemy*>((*it))->isDead()))
-                    {
-                        ++count;
-                    }
-                }
-            }
+        //The mouse is re-centred in this area every update
+        void setViewport(int width, int height) { m_viewportWidth = width; m_viewportHeight = height; }
+        int getViewportWidth() const { return m_viewportWidth; }
+        int getViewportHeight() const { return m_viewportHeight; }
 
-            return count;
-        }
+        //Must be called before initialize(), by default the seed is the current time
+        void setRandomSeed(unsigned int seed) { m_randomSeed = seed; }
 
-        Enemy* findDeadEnemy()
-        {
-            for (EntityIterator it = m_entities.begin(); it != m_entities.end(); ++it)
-            {
-                if ((*it)->getType() == OGRO) {
-                    Enemy* ogro = dynamic_cast<Enemy*>((*it));
-                    if (ogro->isDead())
-                    {
-                        return ogro;
-                    }
-                }
+        //Must be called before initialize(), draws the terrain with Terrain's displaced renderer where it can
+        void setTerrainDisplaced(bool displaced) { m_terrainDisplaced = displaced; }
+        bool isTerrainDisplaced() const { return m_terrainDisplaced; }
 
-            }
+        //How long the collision pass (including removing the dead) took in the last update
+        double getLastCollisionTime() const { return m_lastCollisionTime; }
 
-            return NULL;
-        }
+        unsigned int getEntityCount() const { return m_entities.getCount(); }
+        unsigned int getEntityCount(EntityType type) const { return m_entities.getCount(type); }
+
+        //The ogros that are still alive
+        unsigned int getOgroCount() const { return m_ogroPool.getLiveCount(); }
+
+        //Called when an ogro dies, its body can then be reused by the next ogro spawned
+        void releaseOgro(Ogro* ogro);
 
         std::string getRemainingTimeAsString()
         {
@@ -110,25 +126,37 @@ class GameWorld : private Uncopyable
             y = m_relY;
         }
 
-    private:
-        std::list<Entity*> m_entities; //!< Member variable "m_enemies"
-        std::list<Collider*> m_colliders;
+        /**
+            How far the frame being drawn is between the last two simulation
+            steps, 0 being the previous step and 1 the most recent one
+        */
+        void setRenderInterpolation(float interpolation) { m_renderInterpolation = interpolation; }
+        float getRenderInterpolation() const { return m_renderInterpolation; }
 
-        void registerCollider(Collider* collider);
-        void unregisterCollider(const Collider* collider);
+    private:
+        EntityStore m_entities;
 
-        void registerEntity(Entity* entity);
-        void unregisterEntity(const Entity* entity);
-    
         static const int MAX_ENEMY_COUNT = 15;
         static const int TREE_COUNT = 20;
 
+        //Enough for a busy fight, the pools grow if they run out
+        static const int ROCKET_POOL_SIZE = 32;
+        static const int EXPLOSION_POOL_SIZE = 32;
+        static const unsigned int EXPLOSION_PARTICLE_COUNT = 250;
+        static const float COLLISION_CELL_SIZE;
+
         Player* m_player;
         Landscape* m_landscape;
 
         Vector3 getRandomPosition() const;
+        Entity* findFirstEntity(EntityType type);
+
+        Entity* createEntity(EntityType type);
+        void fillPools();
+        void removeEntity(Entity* entity);
 
-        void clearDeadEntities();
+        void prepareEntities(float dT);
+        void applyCommands();
 
         std::auto_ptr<Camera> m_gameCamera;
 
@@ -141,8 +169,39 @@ class GameWorld : private Uncopyable
         float m_remainingTime;
         const float* m_mvp;
         float m_relX, m_relY;
+        float m_renderInterpolation;
+
+        bool m_headless;
+        int m_viewportWidth;
+        int m_viewportHeight;
+
+        unsigned int m_randomSeed;
+        bool m_terrainDisplaced;
+        double m_lastCollisionTime;
 
         std::auto_ptr<Frustum> m_frustum;
+        std::auto_ptr<CollisionGrid> m_collisionGrid;
+        Narrowphase m_narrowphase;
+
+        //The static entities, rebuilt whenever one is spawned or destroyed
+        StaticBVH m_statics;
+        mutable std::vector<Entity*> m_visibleStatics; //Reused every render to save allocating
+        std::auto_ptr<AssetManager> m_assets;
+        std::auto_ptr<MD2Batch> m_ogroBatch; //NULL if instancing isn't supported
+        std::auto_ptr<JobSystem> m_jobs;
+
+        //Declared after the asset manager so the pooled entities are gone before it is
+        EntityPool<Ogro> m_ogroPool;
+        EntityPool<Rocket> m_rocketPool;
+        EntityPool<Explosion> m_explosionPool;
+
+        static const unsigned int ENTITY_UPDATE_CHUNK_SIZE = 16;
+
+        std::vector<Entity*> m_parallelEntities; //Reused every update to save allocating
+
+        EntityCommandBuffer m_commands;
+        std::vector<EntityCommandBuffer::Command> m_appliedCommands; //Reused every stage to save allocating
+        std::mutex m_spawnMutex; //Guards the pools
 };
 
 #endif // GAMEWORLD_H
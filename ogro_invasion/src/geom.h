@@ -74,6 +74,11 @@ struct Vector3
         return *this;
     }
 
+    const Vector3 operator+(const Vector3& v) const
+    {
+        return Vector3(x + v.x, y + v.y, z + v.z);
+    }
+
     Vector3& operator+=(const Vector3& v)
     {
         this->x += v.x;
@@ -143,6 +143,12 @@ public:
         glUniform3f(location, x, y, z);
     }
 
+    void sendUniform(const string& name, const float x, const float y)
+    {
+        GLuint location = getUniformLocation(name);
+        glUniform2f(location, x, y);
+    }
+
     void sendUniform(const string& name, const float scalar)
     {
         GLuint location = getUniformLocation(name);
@@ -216,7 +222,13 @@ public:
 
     static bool glsl130Supported()
     {
-        std::string version = (char*)glGetString(GL_SHADING_LANGUAGE_VERSION);
+        const GLubyte* versionString = glGetString(GL_SHADING_LANGUAGE_VERSION);
+        if (versionString == NULL)
+        {
+            return false; //No context, e.g. running headless
+        }
+
+        std::string version = (const char*)versionString;
         if (version.find("1.30") != string::npos)
         {
             return true;
@@ -0,0 +1,82 @@
+/**
+    The OpenGL entry points that the simulation code links against, for
+    the headless build which has no GL libraries to link with. The entities
+    keep their drawing code, but a headless world never loads a shader,
+    creates a buffer or renders, so none of these are ever called: they all
+    do nothing, and the extension pointers are left NULL as they would be
+    before glewInit(). If a new GL call stops the headless build linking,
+    make sure it can't be reached without a context before adding it here.
+*/
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+extern "C"
+{
+    void GLAPIENTRY glBindTexture(GLenum, GLuint) {}
+    void GLAPIENTRY glBlendFunc(GLenum, GLenum) {}
+    void GLAPIENTRY glDeleteTextures(GLsizei, const GLuint*) {}
+    void GLAPIENTRY glDepthMask(GLboolean) {}
+    void GLAPIENTRY glDisable(GLenum) {}
+    void GLAPIENTRY glDrawArrays(GLenum, GLint, GLsizei) {}
+    void GLAPIENTRY glDrawElements(GLenum, GLsizei, GLenum, const void*) {}
+    void GLAPIENTRY glEnable(GLenum) {}
+    void GLAPIENTRY glGenTextures(GLsizei, GLuint*) {}
+    void GLAPIENTRY glGetFloatv(GLenum, GLfloat*) {}
+    void GLAPIENTRY glGetIntegerv(GLenum, GLint*) {}
+    void GLAPIENTRY glLoadMatrixf(const GLfloat*) {}
+    void GLAPIENTRY glMultMatrixf(const GLfloat*) {}
+    void GLAPIENTRY glPixelStorei(GLenum, GLint) {}
+    void GLAPIENTRY glPopMatrix() {}
+    void GLAPIENTRY glPushMatrix() {}
+    void GLAPIENTRY glRotatef(GLfloat, GLfloat, GLfloat, GLfloat) {}
+    void GLAPIENTRY glTexEnvi(GLenum, GLenum, GLint) {}
+    void GLAPIENTRY glTexImage1D(GLenum, GLint, GLint, GLsizei, GLint, GLenum, GLenum, const void*) {}
+    void GLAPIENTRY glTexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*) {}
+    void GLAPIENTRY glTexParameteri(GLenum, GLenum, GLint) {}
+    void GLAPIENTRY glTexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*) {}
+    void GLAPIENTRY glTranslatef(GLfloat, GLfloat, GLfloat) {}
+    void GLAPIENTRY gluLookAt(GLdouble, GLdouble, GLdouble, GLdouble, GLdouble, GLdouble, GLdouble, GLdouble, GLdouble) {}
+
+    const GLubyte* GLAPIENTRY glGetString(GLenum) { return NULL; }
+    GLint GLAPIENTRY gluBuild2DMipmaps(GLenum, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*) { return 0; }
+}
+
+GLboolean __GLEW_VERSION_3_0 = GL_FALSE;
+GLboolean __GLEW_VERSION_3_1 = GL_FALSE;
+GLboolean __GLEW_VERSION_3_3 = GL_FALSE;
+
+PFNGLACTIVETEXTUREPROC __glewActiveTexture = NULL;
+PFNGLATTACHSHADERPROC __glewAttachShader = NULL;
+PFNGLBINDATTRIBLOCATIONPROC __glewBindAttribLocation = NULL;
+PFNGLBINDBUFFERPROC __glewBindBuffer = NULL;
+PFNGLBUFFERDATAPROC __glewBufferData = NULL;
+PFNGLBUFFERSUBDATAPROC __glewBufferSubData = NULL;
+PFNGLCOMPILESHADERPROC __glewCompileShader = NULL;
+PFNGLCREATEPROGRAMPROC __glewCreateProgram = NULL;
+PFNGLCREATESHADERPROC __glewCreateShader = NULL;
+PFNGLDELETEBUFFERSPROC __glewDeleteBuffers = NULL;
+PFNGLDELETEPROGRAMPROC __glewDeleteProgram = NULL;
+PFNGLDELETESHADERPROC __glewDeleteShader = NULL;
+PFNGLDETACHSHADERPROC __glewDetachShader = NULL;
+PFNGLDISABLEVERTEXATTRIBARRAYPROC __glewDisableVertexAttribArray = NULL;
+PFNGLDRAWARRAYSINSTANCEDPROC __glewDrawArraysInstanced = NULL;
+PFNGLENABLEVERTEXATTRIBARRAYPROC __glewEnableVertexAttribArray = NULL;
+PFNGLGENBUFFERSPROC __glewGenBuffers = NULL;
+PFNGLGETSHADERINFOLOGPROC __glewGetShaderInfoLog = NULL;
+PFNGLGETSHADERIVPROC __glewGetShaderiv = NULL;
+PFNGLGETUNIFORMLOCATIONPROC __glewGetUniformLocation = NULL;
+PFNGLLINKPROGRAMPROC __glewLinkProgram = NULL;
+PFNGLPRIMITIVERESTARTINDEXPROC __glewPrimitiveRestartIndex = NULL;
+PFNGLSHADERSOURCEPROC __glewShaderSource = NULL;
+PFNGLUNIFORM1FPROC __glewUniform1f = NULL;
+PFNGLUNIFORM1IPROC __glewUniform1i = NULL;
+PFNGLUNIFORM2FPROC __glewUniform2f = NULL;
+PFNGLUNIFORM3FPROC __glewUniform3f = NULL;
+PFNGLUNIFORM4FPROC __glewUniform4f = NULL;
+PFNGLUNIFORMMATRIX3FVPROC __glewUniformMatrix3fv = NULL;
+PFNGLUNIFORMMATRIX4FVPROC __glewUniformMatrix4fv = NULL;
+PFNGLUSEPROGRAMPROC __glewUseProgram = NULL;
+PFNGLVERTEXATTRIBDIVISORPROC __glewVertexAttribDivisor = NULL;
+PFNGLVERTEXATTRIBPOINTERPROC __glewVertexAttribPointer = NULL;
@@ -0,0 +1,96 @@
+/**
+    Runs the game world without a window or an OpenGL context, stepping
+    the simulation as fast as the CPU will go. Nothing is drawn and nobody
+    is at the controls; this is for benchmarking and soak testing the
+    simulation on machines without a GPU.
+
+    Usage: ogro_headless [--ticks <count>] [--tick-rate <steps per second>] [--seed <seed>]
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "gameworld.h"
+#include "nullkeyboardinterface.h"
+#include "nullmouseinterface.h"
+#include "timer.h"
+
+const int DEFAULT_TICK_COUNT = 60 * 60 * 5; //The length of a game at 60 steps per second
+const float DEFAULT_SIMULATION_RATE = 60.0f;
+
+int main(int argc, char** argv)
+{
+    int tickCount = DEFAULT_TICK_COUNT;
+    float simulationRate = DEFAULT_SIMULATION_RATE;
+    bool seeded = false;
+    unsigned int seed = 0;
+
+    for (int i = 1; i < argc - 1; ++i)
+    {
+        if (strcmp(argv[i], "--ticks") == 0)
+        {
+            tickCount = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--tick-rate") == 0)
+        {
+            simulationRate = (float)atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = (unsigned int)strtoul(argv[i + 1], NULL, 10);
+            seeded = true;
+        }
+    }
+
+    if (tickCount <= 0 || simulationRate <= 0.0f)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--ticks <count>] [--tick-rate <steps per second>] [--seed <seed>]" << std::endl;
+        return 1;
+    }
+
+    const float simulationStep = 1.0f / simulationRate;
+
+    NullKeyboardInterface keyboard;
+    NullMouseInterface mouse;
+
+    try
+    {
+        GameWorld world(&keyboard, &mouse, true);
+        if (seeded)
+        {
+            world.setRandomSeed(seed);
+        }
+
+        if (!world.initialize())
+        {
+            std::cerr << "Could not initialize the game world" << std::endl;
+            return 1;
+        }
+
+        Timer timer;
+
+        for (int tick = 0; tick < tickCount; ++tick)
+        {
+            world.update(simulationStep);
+        }
+
+        float seconds = (float)timer.getElapsedSeconds();
+
+        std::cout << "Ran " << tickCount << " steps (" << tickCount * simulationStep
+                  << " seconds of game time) in " << seconds << " seconds" << std::endl;
+
+        if (seconds > 0.0f)
+        {
+            std::cout << float(tickCount) / seconds << " steps per second" << std::endl;
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,436 @@
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+#include "heightquadtree.h"
+#include "terrain.h"
+
+static Vector3 cross(const Vector3& a, const Vector3& b)
+{
+    return Vector3((a.y * b.z) - (a.z * b.y), (a.z * b.x) - (a.x * b.z), (a.x * b.y) - (a.y * b.x));
+}
+
+static float dot(const Vector3& a, const Vector3& b)
+{
+    return (a.x * b.x) + (a.y * b.y) + (a.z * b.z);
+}
+
+/**
+    Moller-Trumbore ray/triangle test. The edges are allowed a little
+    slack so a ray running exactly along the diagonal between a cell's
+    two triangles can't slip through the crack.
+*/
+static bool intersectTriangle(const Vector3& origin, const Vector3& direction, const Vector3& a,
+                              const Vector3& b, const Vector3& c, float& distance)
+{
+    const float EDGE_TOLERANCE = 1e-5f;
+
+    Vector3 edge1 = b - a;
+    Vector3 edge2 = c - a;
+    Vector3 p = cross(direction, edge2);
+
+    float determinant = dot(edge1, p);
+    if (fabs(determinant) < 1e-12f)
+    {
+        return false; //Parallel to the triangle
+    }
+
+    float inverse = 1.0f / determinant;
+    Vector3 s = origin - a;
+    float u = dot(s, p) * inverse;
+    if (u < -EDGE_TOLERANCE || u > 1.0f + EDGE_TOLERANCE)
+    {
+        return false;
+    }
+
+    Vector3 q = cross(s, edge1);
+    float v = dot(direction, q) * inverse;
+    if (v < -EDGE_TOLERANCE || u + v > 1.0f + EDGE_TOLERANCE)
+    {
+        return false;
+    }
+
+    distance = dot(edge2, q) * inverse;
+    return true;
+}
+
+HeightQuadtree::HeightQuadtree(const Terrain& terrain, int leafSize):
+m_terrain(terrain),
+m_leafSize(leafSize),
+m_cells(terrain.getWidth() - 1)
+{
+    Level level;
+    level.size = (m_cells + leafSize - 1) / leafSize;
+    level.span = leafSize;
+    level.nodes.resize(level.size * level.size);
+    m_levels.push_back(level);
+
+    while (level.size > 1)
+    {
+        level.size = (level.size + 1) / 2;
+        level.span *= 2;
+        level.nodes.resize(level.size * level.size);
+        m_levels.push_back(level);
+    }
+}
+
+void HeightQuadtree::rebuild()
+{
+    const int size = m_levels[0].size;
+
+    for (int leafZ = 0; leafZ < size; ++leafZ)
+    {
+        for (int leafX = 0; leafX < size; ++leafX)
+        {
+            updateLeaf(leafX, leafZ);
+        }
+    }
+
+    updateParents();
+}
+
+void HeightQuadtree::updateRegion(int minX, int minZ, int maxX, int maxZ)
+{
+    const int size = m_levels[0].size;
+
+    //A corner on the edge between two leaves belongs to both
+    int minLeafX = std::max((minX - 1) / m_leafSize, 0);
+    int minLeafZ = std::max((minZ - 1) / m_leafSize, 0);
+    int maxLeafX = std::min(maxX / m_leafSize, size - 1);
+    int maxLeafZ = std::min(maxZ / m_leafSize, size - 1);
+
+    for (int leafZ = minLeafZ; leafZ <= maxLeafZ; ++leafZ)
+    {
+        for (int leafX = minLeafX; leafX <= maxLeafX; ++leafX)
+        {
+            updateLeaf(leafX, leafZ);
+        }
+    }
+
+    updateParents(minLeafX, minLeafZ, maxLeafX, maxLeafZ);
+}
+
+void HeightQuadtree::updateLeaf(int leafX, int leafZ)
+{
+    //Each leaf includes the row of heights it shares with the next one
+    int minX = leafX * m_leafSize;
+    int minZ = leafZ * m_leafSize;
+    int maxX = std::min(minX + m_leafSize, m_cells);
+    int maxZ = std::min(minZ + m_leafSize, m_cells);
+
+    Bounds& bounds = m_levels[0].nodes[(leafZ * m_levels[0].size) + leafX];
+    bounds.lowest = bounds.highest = m_terrain.getGridHeight(minX, minZ);
+
+    for (int z = minZ; z <= maxZ; ++z)
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            float height = m_terrain.getGridHeight(x, z);
+            bounds.lowest = std::min(bounds.lowest, height);
+            bounds.highest = std::max(bounds.highest, height);
+        }
+    }
+}
+
+void HeightQuadtree::setLeafBounds(int leafX, int leafZ, float lowest, float highest)
+{
+    Bounds& bounds = m_levels[0].nodes[(leafZ * m_levels[0].size) + leafX];
+    bounds.lowest = lowest;
+    bounds.highest = highest;
+}
+
+void HeightQuadtree::updateParents()
+{
+    updateParents(0, 0, m_levels[0].size - 1, m_levels[0].size - 1);
+}
+
+void HeightQuadtree::updateParents(int minLeafX, int minLeafZ, int maxLeafX, int maxLeafZ)
+{
+    int minX = minLeafX;
+    int minZ = minLeafZ;
+    int maxX = maxLeafX;
+    int maxZ = maxLeafZ;
+
+    for (unsigned int level = 1; level < m_levels.size(); ++level)
+    {
+        const Level& children = m_levels[level - 1];
+        Level& parents = m_levels[level];
+
+        //Only the parents of the nodes that changed on the level below
+        minX /= 2;
+        minZ /= 2;
+        maxX /= 2;
+        maxZ /= 2;
+
+        for (int z = minZ; z <= maxZ; ++z)
+        {
+            for (int x = minX; x <= maxX; ++x)
+            {
+                Bounds& bounds = parents.nodes[(z * parents.size) + x];
+                bounds = children.nodes[(z * 2 * children.size) + (x * 2)];
+
+                //The last row and column may only have one child along that side
+                for (int childZ = z * 2; childZ < std::min((z * 2) + 2, children.size); ++childZ)
+                {
+                    for (int childX = x * 2; childX < std::min((x * 2) + 2, children.size); ++childX)
+                    {
+                        const Bounds& child = children.nodes[(childZ * children.size) + childX];
+                        bounds.lowest = std::min(bounds.lowest, child.lowest);
+                        bounds.highest = std::max(bounds.highest, child.highest);
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool HeightQuadtree::raycast(const Vector3& origin, const Vector3& direction, float maxDistance,
+                             float& distance) const
+{
+    Ray ray;
+    ray.origin = origin;
+    ray.direction = direction;
+    ray.inverse = Vector3((direction.x != 0.0f) ? 1.0f / direction.x : 0.0f,
+                          (direction.y != 0.0f) ? 1.0f / direction.y : 0.0f,
+                          (direction.z != 0.0f) ? 1.0f / direction.z : 0.0f);
+
+    distance = maxDistance;
+    return raycastNode(m_levels.size() - 1, 0, 0, ray, distance);
+}
+
+/**
+    Clips the ray to a node's box, giving back the part of it between
+    start and end that is inside. The box is in grid cells across and the
+    node's height range up.
+*/
+bool HeightQuadtree::intersectBox(const Ray& ray, int minX, int minZ, int maxX, int maxZ, const Bounds& bounds,
+                                  float& start, float& end) const
+{
+    const float boxMin[3] = { float(minX), bounds.lowest, float(minZ) };
+    const float boxMax[3] = { float(maxX), bounds.highest, float(maxZ) };
+    const float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+    const float direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+    const float inverse[3] = { ray.inverse.x, ray.inverse.y, ray.inverse.z };
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (direction[axis] == 0.0f)
+        {
+            //Running parallel to this pair of sides, either always between them or never
+            if (origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis])
+            {
+                return false;
+            }
+            continue;
+        }
+
+        float entering = (boxMin[axis] - origin[axis]) * inverse[axis];
+        float leaving = (boxMax[axis] - origin[axis]) * inverse[axis];
+        if (entering > leaving)
+        {
+            std::swap(entering, leaving);
+        }
+
+        start = std::max(start, entering);
+        end = std::min(end, leaving);
+        if (start > end)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool HeightQuadtree::raycastNode(int level, int nodeX, int nodeZ, const Ray& ray, float& best) const
+{
+    const Level& nodes = m_levels[level];
+
+    int minX = nodeX * nodes.span;
+    int minZ = nodeZ * nodes.span;
+    int maxX = std::min(minX + nodes.span, m_cells);
+    int maxZ = std::min(minZ + nodes.span, m_cells);
+
+    float start = 0.0f;
+    float end = best;
+    if (!intersectBox(ray, minX, minZ, maxX, maxZ, nodes.nodes[(nodeZ * nodes.size) + nodeX], start, end))
+    {
+        return false; //Nothing under this node can be hit
+    }
+
+    if (level == 0)
+    {
+        return raycastLeaf(minX, minZ, maxX, maxZ, ray, start, end, best);
+    }
+
+    //Visit the child nearest the ray's origin first, the hits it finds shorten
+    //the ray and let more of the others be skipped
+    const int flipX = (ray.direction.x < 0.0f) ? 1 : 0;
+    const int flipZ = (ray.direction.z < 0.0f) ? 1 : 0;
+    const int childSize = m_levels[level - 1].size;
+
+    bool hit = false;
+    for (int i = 0; i < 4; ++i)
+    {
+        int childX = (nodeX * 2) + ((i & 1) ^ flipX);
+        int childZ = (nodeZ * 2) + ((i >> 1) ^ flipZ);
+
+        if (childX < childSize && childZ < childSize && raycastNode(level - 1, childX, childZ, ray, best))
+        {
+            hit = true;
+        }
+    }
+
+    return hit;
+}
+
+/**
+    Steps through the leaf's cells in the order the ray crosses them
+    (a 2D DDA over x and z), so the first cell that is hit holds the
+    nearest hit in the leaf.
+*/
+bool HeightQuadtree::raycastLeaf(int minX, int minZ, int maxX, int maxZ, const Ray& ray, float start, float end,
+                                 float& best) const
+{
+    Vector3 entry = ray.origin + ray.direction * start;
+    int x = std::min(std::max((int)floorf(entry.x), minX), maxX - 1);
+    int z = std::min(std::max((int)floorf(entry.z), minZ), maxZ - 1);
+
+    const int stepX = (ray.direction.x > 0.0f) ? 1 : -1;
+    const int stepZ = (ray.direction.z > 0.0f) ? 1 : -1;
+
+    float nextX = FLT_MAX;
+    float nextZ = FLT_MAX;
+    float deltaX = FLT_MAX;
+    float deltaZ = FLT_MAX;
+
+    if (ray.direction.x != 0.0f)
+    {
+        nextX = (float(x + ((stepX > 0) ? 1 : 0)) - ray.origin.x) * ray.inverse.x;
+        deltaX = fabs(ray.inverse.x);
+    }
+
+    if (ray.direction.z != 0.0f)
+    {
+        nextZ = (float(z + ((stepZ > 0) ? 1 : 0)) - ray.origin.z) * ray.inverse.z;
+        deltaZ = fabs(ray.inverse.z);
+    }
+
+    while (true)
+    {
+        if (raycastCell(x, z, ray, best))
+        {
+            return true;
+        }
+
+        if (nextX < nextZ)
+        {
+            x += stepX;
+            if (nextX > end || x < minX || x >= maxX)
+            {
+                break;
+            }
+            nextX += deltaX;
+        }
+        else
+        {
+            z += stepZ;
+            if (nextZ > end || z < minZ || z >= maxZ)
+            {
+                break;
+            }
+            nextZ += deltaZ;
+        }
+    }
+
+    return false;
+}
+
+bool HeightQuadtree::raycastCell(int x, int z, const Ray& ray, float& best) const
+{
+    //Split the same way as the terrain is drawn
+    Vector3 corner00(float(x), m_terrain.getGridHeight(x, z), float(z));
+    Vector3 corner10(float(x + 1), m_terrain.getGridHeight(x + 1, z), float(z));
+    Vector3 corner01(float(x), m_terrain.getGridHeight(x, z + 1), float(z + 1));
+    Vector3 corner11(float(x + 1), m_terrain.getGridHeight(x + 1, z + 1), float(z + 1));
+
+    bool hit = false;
+    float distance;
+
+    if (intersectTriangle(ray.origin, ray.direction, corner00, corner01, corner10, distance) &&
+        distance >= 0.0f && distance <= best)
+    {
+        best = distance;
+        hit = true;
+    }
+
+    if (intersectTriangle(ray.origin, ray.direction, corner01, corner11, corner10, distance) &&
+        distance >= 0.0f && distance <= best)
+    {
+        best = distance;
+        hit = true;
+    }
+
+    return hit;
+}
+
+void HeightQuadtree::getHeightRange(int minX, int minZ, int maxX, int maxZ, float& lowest, float& highest) const
+{
+    Bounds range;
+    range.lowest = FLT_MAX;
+    range.highest = -FLT_MAX;
+
+    getNodeRange(m_levels.size() - 1, 0, 0, std::max(minX, 0), std::max(minZ, 0),
+                 std::min(maxX, m_cells), std::min(maxZ, m_cells), range);
+
+    lowest = range.lowest;
+    highest = range.highest;
+}
+
+void HeightQuadtree::getNodeRange(int level, int nodeX, int nodeZ, int minX, int minZ, int maxX, int maxZ,
+                                  Bounds& range) const
+{
+    const Level& nodes = m_levels[level];
+
+    int nodeMinX = nodeX * nodes.span;
+    int nodeMinZ = nodeZ * nodes.span;
+    int nodeMaxX = std::min(nodeMinX + nodes.span, m_cells);
+    int nodeMaxZ = std::min(nodeMinZ + nodes.span, m_cells);
+
+    if (nodeMaxX < minX || nodeMinX > maxX || nodeMaxZ < minZ || nodeMinZ > maxZ)
+    {
+        return;
+    }
+
+    //A node entirely inside the range can answer for everything under it
+    if (minX <= nodeMinX && nodeMaxX <= maxX && minZ <= nodeMinZ && nodeMaxZ <= maxZ)
+    {
+        const Bounds& bounds = nodes.nodes[(nodeZ * nodes.size) + nodeX];
+        range.lowest = std::min(range.lowest, bounds.lowest);
+        range.highest = std::max(range.highest, bounds.highest);
+        return;
+    }
+
+    if (level == 0)
+    {
+        for (int z = std::max(minZ, nodeMinZ); z <= std::min(maxZ, nodeMaxZ); ++z)
+        {
+            for (int x = std::max(minX, nodeMinX); x <= std::min(maxX, nodeMaxX); ++x)
+            {
+                float height = m_terrain.getGridHeight(x, z);
+                range.lowest = std::min(range.lowest, height);
+                range.highest = std::max(range.highest, height);
+            }
+        }
+        return;
+    }
+
+    const int childSize = m_levels[level - 1].size;
+    for (int childZ = nodeZ * 2; childZ < std::min((nodeZ * 2) + 2, childSize); ++childZ)
+    {
+        for (int childX = nodeX * 2; childX < std::min((nodeX * 2) + 2, childSize); ++childX)
+        {
+            getNodeRange(level - 1, childX, childZ, minX, minZ, maxX, maxZ, range);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef HEIGHTQUADTREE_H_INCLUDED
+#define HEIGHTQUADTREE_H_INCLUDED
+
+#include <vector>
+
+#include "geom.h"
+#include "uncopyable.h"
+
+class Terrain;
+
+/**
+    A min/max quadtree over a terrain's heights. The leaves are square
+    blocks of grid cells holding the lowest and highest point of the
+    block, each level above halves the number of nodes along a side
+    until a single node covers the whole map.
+
+    Rays are walked down the tree and any node whose box they miss is
+    skipped along with everything under it, so only the few leaves the
+    ray actually passes over have their triangles tested. Height range
+    queries use whole nodes where they can in the same way.
+
+    Everything here works in grid space, x and z run from 0 to the
+    terrain width - 1 and are converted by the terrain.
+*/
+class HeightQuadtree : private Uncopyable
+{
+public:
+    HeightQuadtree(const Terrain& terrain, int leafSize);
+
+    //Rescans every height, or only sets the leaves (e.g. from a tile table)
+    void rebuild();
+    void setLeafBounds(int leafX, int leafZ, float lowest, float highest);
+    void updateParents();
+
+    //Rescans the leaves touching the grid corners given (inclusive) and
+    //the nodes above them, after the heights there have changed
+    void updateRegion(int minX, int minZ, int maxX, int maxZ);
+
+    int getLeafSize() const { return m_leafSize; }
+    int getLeavesPerSide() const { return m_levels.empty() ? 0 : m_levels[0].size; }
+
+    /**
+        Finds the first point where the ray starting at origin hits the
+        ground, no further than maxDistance along direction (which doesn't
+        have to be normalized, distances are in multiples of it).
+    */
+    bool raycast(const Vector3& origin, const Vector3& direction, float maxDistance, float& distance) const;
+
+    //The lowest and highest points between two grid corners (inclusive)
+    void getHeightRange(int minX, int minZ, int maxX, int maxZ, float& lowest, float& highest) const;
+
+private:
+    struct Bounds
+    {
+        float lowest;
+        float highest;
+    };
+
+    struct Level
+    {
+        int size; //Nodes along each side
+        int span; //Grid cells along each side of a node
+        std::vector<Bounds> nodes;
+    };
+
+    struct Ray
+    {
+        Vector3 origin;
+        Vector3 direction;
+        Vector3 inverse;
+    };
+
+    void updateLeaf(int leafX, int leafZ);
+    void updateParents(int minLeafX, int minLeafZ, int maxLeafX, int maxLeafZ);
+
+    bool raycastNode(int level, int nodeX, int nodeZ, const Ray& ray, float& best) const;
+    bool raycastLeaf(int minX, int minZ, int maxX, int maxZ, const Ray& ray, float start, float end,
+                     float& best) const;
+    bool raycastCell(int x, int z, const Ray& ray, float& best) const;
+    bool intersectBox(const Ray& ray, int minX, int minZ, int maxX, int maxZ, const Bounds& bounds,
+                      float& start, float& end) const;
+    void getNodeRange(int level, int nodeX, int nodeZ, int minX, int minZ, int maxX, int maxZ,
+                      Bounds& range) const;
+
+    const Terrain& m_terrain;
+    int m_leafSize;
+    int m_cells; //Grid cells along each side of the terrain
+    std::vector<Level> m_levels; //Leaves first
+};
+
+#endif // HEIGHTQUADTREE_H_INCLUDED
@@ -0,0 +1,222 @@
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include "inputscript.h"
+#include "mouseinterface.h"
+
+using std::string;
+using std::vector;
+
+InputScript::InputScript():
+m_nextEvent(0)
+{
+}
+
+bool InputScript::load(const string& filename)
+{
+    std::ifstream fileIn(filename.c_str());
+    if (!fileIn.good())
+    {
+        std::cerr << "Could not open the input script: " << filename << std::endl;
+        return false;
+    }
+
+    return load(fileIn);
+}
+
+bool InputScript::load(std::istream& stream)
+{
+    m_events.clear();
+    m_nextEvent = 0;
+
+    string line;
+    int lineNumber = 0;
+    while (std::getline(stream, line))
+    {
+        ++lineNumber;
+
+        //Strip comments
+        string::size_type comment = line.find('#');
+        if (comment != string::npos)
+        {
+            line.erase(comment);
+        }
+
+        std::istringstream lineIn(line);
+        int step;
+        string event;
+        if (!(lineIn >> step))
+        {
+            continue; //Blank line
+        }
+
+        lineIn >> event;
+
+        bool valid = true;
+        if (event == "keydown" || event == "keyup")
+        {
+            string keyName;
+            lineIn >> keyName;
+            BOGLGPKeyCode key = keyFromName(keyName);
+            valid = (key != KC_INVALID);
+            addKeyEvent(step, (event == "keydown") ? KEY_DOWN : KEY_UP, key);
+        }
+        else if (event == "buttondown" || event == "buttonup")
+        {
+            int button = -1;
+            lineIn >> button;
+            valid = (button == 0 || button == 1);
+            addButtonEvent(step, (event == "buttondown") ? BUTTON_DOWN : BUTTON_UP, button);
+        }
+        else if (event == "mousemove")
+        {
+            int dx = 0, dy = 0;
+            valid = !(lineIn >> dx >> dy).fail();
+            addMouseMove(step, dx, dy);
+        }
+        else
+        {
+            valid = false;
+        }
+
+        if (!valid || step < 0)
+        {
+            std::cerr << "Invalid input script event on line " << lineNumber << ": " << line << std::endl;
+            m_events.clear();
+            return false;
+        }
+    }
+
+    //Events for the same step keep the order they were written in
+    std::stable_sort(m_events.begin(), m_events.end());
+    return true;
+}
+
+void InputScript::loadDefault(int length)
+{
+    m_events.clear();
+    m_nextEvent = 0;
+
+    /*
+        Walk forward for five seconds then stop for two, sweeping the view
+        left and right every second and firing twice a second. This gives
+        the collision code plenty of rockets and explosions to deal with.
+    */
+    const int WALK_CYCLE = 420;
+    const int WALK_TIME = 300;
+    const int TURN_INTERVAL = 60;
+    const int FIRE_INTERVAL = 30;
+
+    for (int step = 0; step < length; ++step)
+    {
+        if (step % WALK_CYCLE == 0)
+        {
+            addKeyEvent(step, KEY_DOWN, KC_w);
+        }
+        else if (step % WALK_CYCLE == WALK_TIME)
+        {
+            addKeyEvent(step, KEY_UP, KC_w);
+        }
+
+        if (step % TURN_INTERVAL == 0)
+        {
+            int direction = ((step / TURN_INTERVAL) % 2 == 0) ? 1 : -1;
+            addMouseMove(step, 40 * direction, 0);
+        }
+
+        if (step % FIRE_INTERVAL == 0)
+        {
+            addButtonEvent(step, BUTTON_DOWN, 0);
+        }
+        else if (step % FIRE_INTERVAL == 1)
+        {
+            addButtonEvent(step, BUTTON_UP, 0);
+        }
+    }
+}
+
+void InputScript::apply(int step, KeyboardInterface* keyboard, MouseInterface* mouse)
+{
+    while (m_nextEvent < m_events.size() && m_events[m_nextEvent].step <= step)
+    {
+        const Event& event = m_events[m_nextEvent++];
+        switch (event.type)
+        {
+            case KEY_DOWN:
+                keyboard->handleKeyDown(event.key);
+            break;
+            case KEY_UP:
+                keyboard->handleKeyUp(event.key);
+            break;
+            case BUTTON_DOWN:
+                mouse->toggleMousebutton(event.button, true);
+            break;
+            case BUTTON_UP:
+                mouse->toggleMousebutton(event.button, false);
+            break;
+            case MOUSE_MOVE:
+            {
+                int x, y;
+                mouse->getMousePos(x, y);
+                mouse->setMousePos(x + event.dx, y + event.dy);
+            }
+            break;
+        }
+    }
+}
+
+int InputScript::getLength() const
+{
+    return m_events.empty() ? 0 : m_events.back().step;
+}
+
+void InputScript::addKeyEvent(int step, EventType type, BOGLGPKeyCode key)
+{
+    Event event;
+    event.step = step;
+    event.type = type;
+    event.key = key;
+    event.button = 0;
+    event.dx = event.dy = 0;
+    m_events.push_back(event);
+}
+
+void InputScript::addButtonEvent(int step, EventType type, int button)
+{
+    Event event;
+    event.step = step;
+    event.type = type;
+    event.key = KC_INVALID;
+    event.button = button;
+    event.dx = event.dy = 0;
+    m_events.push_back(event);
+}
+
+void InputScript::addMouseMove(int step, int dx, int dy)
+{
+    Event event;
+    event.step = step;
+    event.type = MOUSE_MOVE;
+    event.key = KC_INVALID;
+    event.button = 0;
+    event.dx = dx;
+    event.dy = dy;
+    m_events.push_back(event);
+}
+
+BOGLGPKeyCode InputScript::keyFromName(const string& name)
+{
+    if (name == "up") return KC_UP;
+    if (name == "down") return KC_DOWN;
+    if (name == "left") return KC_LEFT;
+    if (name == "right") return KC_RIGHT;
+    if (name == "space") return KC_SPACE;
+    if (name == "w") return KC_w;
+    if (name == "a") return KC_a;
+    if (name == "s") return KC_s;
+    if (name == "d") return KC_d;
+
+    return KC_INVALID;
+}
@@ -0,0 +1,79 @@
+#ifndef INPUTSCRIPT_H_INCLUDED
+#define INPUTSCRIPT_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <istream>
+
+#include "uncopyable.h"
+#include "keyboardinterface.h"
+
+class MouseInterface;
+
+/**
+    A list of input events, each tagged with the simulation step it happens
+    on, that can be played back through the keyboard and mouse interfaces.
+    Played back at a fixed step with a fixed random seed the game does
+    exactly the same thing every run.
+
+    Scripts are plain text, one event per line:
+
+        # step  event       arguments
+        0       keydown     w
+        300     keyup       w
+        310     mousemove   40 0
+        320     buttondown  0
+        321     buttonup    0
+
+    Keys are up, down, left, right, space, w, a, s and d. Mouse moves
+    are relative to where the game last put the cursor.
+*/
+class InputScript : private Uncopyable
+{
+public:
+    InputScript();
+
+    bool load(const std::string& filename);
+    bool load(std::istream& stream);
+
+    //A few minutes of walking around, turning and firing, used when no script is given
+    void loadDefault(int length);
+
+    //Plays back every event for this step, call it before updating the world
+    void apply(int step, KeyboardInterface* keyboard, MouseInterface* mouse);
+
+    //The step of the last event, 0 if there are none
+    int getLength() const;
+
+private:
+    enum EventType
+    {
+        KEY_DOWN,
+        KEY_UP,
+        BUTTON_DOWN,
+        BUTTON_UP,
+        MOUSE_MOVE
+    };
+
+    struct Event
+    {
+        int step;
+        EventType type;
+        BOGLGPKeyCode key;
+        int button;
+        int dx, dy;
+
+        bool operator<(const Event& rhs) const { return step < rhs.step; }
+    };
+
+    void addKeyEvent(int step, EventType type, BOGLGPKeyCode key);
+    void addButtonEvent(int step, EventType type, int button);
+    void addMouseMove(int step, int dx, int dy);
+
+    static BOGLGPKeyCode keyFromName(const std::string& name);
+
+    std::vector<Event> m_events;
+    unsigned int m_nextEvent;
+};
+
+#endif // INPUTSCRIPT_H_INCLUDED
@@ -0,0 +1,187 @@
+#include <cassert>
+
+#include "jobsystem.h"
+
+using std::vector;
+
+//Which queue the current thread owns. Threads that aren't workers
+//(i.e. the one that created the job system) use queue 0.
+static thread_local unsigned int t_queueIndex = 0;
+
+JobSystem::JobSystem(unsigned int workerCount):
+m_queuedJobs(0),
+m_running(true)
+{
+    if (workerCount == 0)
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        workerCount = (cores > 1) ? cores - 1 : 0;
+    }
+
+    //One queue for the calling thread and one for each worker
+    for (unsigned int i = 0; i < workerCount + 1; ++i)
+    {
+        m_queues.push_back(new WorkQueue());
+    }
+
+    for (unsigned int i = 1; i < m_queues.size(); ++i)
+    {
+        m_workers.push_back(std::thread(&JobSystem::workerLoop, this, i));
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    m_running = false;
+    wakeWorkers();
+
+    for (vector<std::thread>::iterator worker = m_workers.begin(); worker != m_workers.end(); ++worker)
+    {
+        (*worker).join();
+    }
+
+    for (vector<WorkQueue*>::iterator queue = m_queues.begin(); queue != m_queues.end(); ++queue)
+    {
+        delete (*queue);
+    }
+}
+
+void JobSystem::submit(const Function& function, Counter& counter)
+{
+    Job job;
+    job.function = function;
+    job.counter = &counter;
+
+    counter.m_pending++;
+    push(t_queueIndex, job);
+    wakeWorkers();
+}
+
+void JobSystem::wait(Counter& counter)
+{
+    //Rather than block, help out until our jobs are done
+    while (!counter.isDone())
+    {
+        Job job;
+        if (findJob(t_queueIndex, job))
+        {
+            execute(job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::parallelFor(unsigned int count, unsigned int chunkSize, const RangeFunction& function)
+{
+    assert(chunkSize > 0);
+
+    //Not worth waking anyone up for a single chunk
+    if (count <= chunkSize || m_workers.empty())
+    {
+        if (count > 0)
+        {
+            function(0, count);
+        }
+        return;
+    }
+
+    Counter counter;
+    for (unsigned int begin = 0; begin < count; begin += chunkSize)
+    {
+        unsigned int end = (begin + chunkSize < count) ? begin + chunkSize : count;
+
+        Job job;
+        job.function = std::bind(function, begin, end);
+        job.counter = &counter;
+
+        counter.m_pending++;
+        push(t_queueIndex, job);
+    }
+
+    wakeWorkers();
+    wait(counter);
+}
+
+void JobSystem::push(unsigned int queue, const Job& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+        m_queues[queue]->jobs.push_back(job);
+    }
+
+    m_queuedJobs++;
+}
+
+bool JobSystem::findJob(unsigned int queue, Job& job)
+{
+    //Our own work first, newest first as it's the most likely to be in the cache
+    {
+        WorkQueue* own = m_queues[queue];
+        std::lock_guard<std::mutex> lock(own->mutex);
+        if (!own->jobs.empty())
+        {
+            job = own->jobs.back();
+            own->jobs.pop_back();
+            m_queuedJobs--;
+            return true;
+        }
+    }
+
+    //Then steal the oldest job from someone else
+    for (unsigned int i = 1; i < m_queues.size(); ++i)
+    {
+        WorkQueue* victim = m_queues[(queue + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim->mutex);
+        if (!victim->jobs.empty())
+        {
+            job = victim->jobs.front();
+            victim->jobs.pop_front();
+            m_queuedJobs--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobSystem::execute(Job& job)
+{
+    job.function();
+    job.counter->m_pending--;
+}
+
+void JobSystem::workerLoop(unsigned int queue)
+{
+    t_queueIndex = queue;
+
+    while (m_running)
+    {
+        Job job;
+        if (findJob(queue, job))
+        {
+            execute(job);
+            continue;
+        }
+
+        //Nothing to do, sleep until something is submitted
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        while (m_running && m_queuedJobs.load() == 0)
+        {
+            m_wakeCondition.wait(lock);
+        }
+    }
+}
+
+void JobSystem::wakeWorkers()
+{
+    //Taking the lock means a worker can't miss this between checking
+    //for jobs and going to sleep
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+
+    m_wakeCondition.notify_all();
+}
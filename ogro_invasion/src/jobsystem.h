@@ -0,0 +1,87 @@
+#ifndef JOBSYSTEM_H_INCLUDED
+#define JOBSYSTEM_H_INCLUDED
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "uncopyable.h"
+
+/**
+    A pool of worker threads that run small jobs. Every thread has its own
+    queue, it takes work from the back of its own queue and when that is
+    empty it steals from the front of the others, so the threads keep each
+    other busy without fighting over one shared queue.
+
+    The thread that created the job system counts as a worker too: jobs it
+    submits go on its queue and wait() runs jobs until the ones it is
+    waiting for are done. Only that thread and the workers may submit jobs.
+*/
+class JobSystem : private Uncopyable
+{
+public:
+    typedef std::function<void()> Function;
+    typedef std::function<void(unsigned int begin, unsigned int end)> RangeFunction;
+
+    //Counts the jobs still running in a batch, wait() on it to know they're done
+    class Counter : private Uncopyable
+    {
+    public:
+        Counter(): m_pending(0) { }
+        bool isDone() const { return m_pending.load() == 0; }
+
+    private:
+        friend class JobSystem;
+        std::atomic<int> m_pending;
+    };
+
+    //0 workers means one per core, minus the calling thread
+    explicit JobSystem(unsigned int workerCount = 0);
+    virtual ~JobSystem();
+
+    void submit(const Function& function, Counter& counter);
+    void wait(Counter& counter);
+
+    /**
+        Splits [0, count) into chunks of chunkSize and runs them across all
+        the threads, returning once every chunk has finished.
+    */
+    void parallelFor(unsigned int count, unsigned int chunkSize, const RangeFunction& function);
+
+    //Includes the thread that owns the job system
+    unsigned int getThreadCount() const { return m_queues.size(); }
+
+private:
+    struct Job
+    {
+        Function function;
+        Counter* counter;
+    };
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void push(unsigned int queue, const Job& job);
+    bool findJob(unsigned int queue, Job& job);
+    void execute(Job& job);
+    void workerLoop(unsigned int queue);
+    void wakeWorkers();
+
+    std::vector<WorkQueue*> m_queues;
+    std::vector<std::thread> m_workers;
+
+    std::atomic<int> m_queuedJobs;
+    std::atomic<bool> m_running;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeCondition;
+};
+
+#endif // JOBSYSTEM_H_INCLUDED
@@ -5,6 +5,7 @@
 #include <cassert>
 #include "landscape.h"
 #include "terraincollider.h"
+#include "gameworld.h"
 
 using std::string;
 
@@ -14,7 +15,7 @@ Entity(world),
 m_terrain(vertexShader, fragmentShader, waterVert, waterFrag),
 m_heightmap(heightmap)
 {
-    m_collider = std::auto_ptr<Collider>(new TerrainCollider(this, &m_terrain));
+    m_collider = std::auto_ptr<TerrainCollider>(new TerrainCollider(this, &m_terrain));
 }
 
 Landscape::~Landscape()
@@ -29,10 +30,40 @@ bool Landscape::onInitialize()
     const string grassTexture = "data/textures/grass.tga";
     const string heightTexture = "data/textures/height.tga";
     const string waterTexture = "data/textures/water.tga";
-    bool result = m_terrain.loadHeightmap(m_heightmap, grassTexture, heightTexture, 65, true, waterTexture);
+    const float HEIGHT_SCALE = 4.0f;
+
+    //Tiled heightmaps are streamed rather than loaded
+    const string tiledExtension = ".tiles";
+    bool tiled = m_heightmap.size() > tiledExtension.size() &&
+                 m_heightmap.compare(m_heightmap.size() - tiledExtension.size(), tiledExtension.size(), tiledExtension) == 0;
+
+    m_terrain.setJobSystem(getWorld()->getJobSystem());
+
+    bool result;
+    if (tiled)
+    {
+        result = m_terrain.loadTiledHeightmap(m_heightmap, true);
+        if (result)
+        {
+            m_terrain.normalizeTerrain();
+            m_terrain.scaleHeights(HEIGHT_SCALE);
+        }
+    }
+    else
+    {
+        //The cache goes in the working directory, not next to the heightmap in the
+        //data folder that's shipped (which may not even be writable)
+        string::size_type nameStart = m_heightmap.find_last_of("/\\");
+        string cacheFile = (nameStart == string::npos ? m_heightmap : m_heightmap.substr(nameStart + 1)) + ".cache";
+        result = m_terrain.loadBakedHeightmap(m_heightmap, HEIGHT_SCALE, cacheFile, true);
+    }
+
     if (result) {
-        m_terrain.normalizeTerrain();
-        m_terrain.scaleHeights(4.0f);
+        if (!getWorld()->isHeadless())
+        {
+            m_terrain.setDisplacementEnabled(getWorld()->isTerrainDisplaced());
+            result = m_terrain.initializeGraphics(grassTexture, heightTexture, waterTexture);
+        }
     }
 
     return result;
@@ -71,7 +102,7 @@ void Landscape::onCollision(Entity* entity)
     */
     Vector3 entityPos = entity->getPosition();
     float entityHeight = entityPos.y;
-    float terrainHeight = m_terrain.getHeightAt(entityPos.x, entityPos.z);
+    float terrainHeight = m_collider->getGroundHeight(entity->getCollider());
     float entityRadius = entity->getCollider()->getRadius();
 
     entityPos.y = terrainHeight + entityRadius;
@@ -6,13 +6,12 @@
 
 #include "entity.h"
 #include "terrain.h"
-
-class Collider;
+#include "terraincollider.h"
 
 class Landscape : public Entity {
 private:
     Terrain m_terrain;
-    std::auto_ptr<Collider> m_collider;
+    std::auto_ptr<TerrainCollider> m_collider;
     std::string m_heightmap;
 
     virtual bool onInitialize();
@@ -21,6 +20,7 @@ private:
     virtual void onCollision(Entity* entity);
     virtual void onPrepare(float dT);
     virtual void onPostRender();
+    virtual void onMove() { throw std::logic_error("Attempted to move the landscape"); }
     
 
 public:
@@ -30,13 +30,7 @@ public:
 
     virtual Collider* getCollider() { return m_collider.get(); }
 
-    Vector3 getPosition() const { return Vector3(0.0f, 0.0f, 0.0f); }
-    void setPosition(const Vector3& v) { throw std::logic_error("Attempted to move the landscape"); }
     Vector3 getVelocity() const { return Vector3(0.0f, 0.0f, 0.0f); }
-    float getYaw() const { return 0.0f; }
-    float getPitch() const { return 0.0f; }
-    void setYaw(const float yaw) { }
-    void setPitch(const float pitch) { }
 
     EntityType getType() const { return LANDSCAPE; }
     Terrain* getTerrain() { return &m_terrain; }
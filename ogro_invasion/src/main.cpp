@@ -1,6 +1,8 @@
 #include "glxwindow.h"
 
 #include "example.h"
+#include "gameworld.h"
+#include "profiler.h"
 
 
 // standard C++ libraries
@@ -8,9 +10,20 @@
 #include <iostream>
 #include <stdexcept>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 
 GLFWwindow* gWindow = NULL;
 
+//The simulation always advances in steps of 1 / rate seconds, however fast we draw
+const float DEFAULT_SIMULATION_RATE = 60.0f;
+
+//If we fall this many steps behind in one frame we drop the rest rather
+//than spiralling further behind trying to catch up
+const int MAX_STEPS_PER_FRAME = 5;
+
+const char* const TRACE_FILENAME = "ogro_trace.json";
+
 void OnError(int errorCode, const char* msg) {
     throw std::runtime_error(msg);
 }
@@ -19,6 +32,30 @@ void OnError(int errorCode, const char* msg) {
 
 int main(int argc, char** argv)
 {
+    //The tick rate can be changed with --tick-rate <steps per second>,
+    //--displaced-terrain draws the terrain displaced on the GPU
+    float simulationRate = DEFAULT_SIMULATION_RATE;
+    bool displacedTerrain = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+        {
+            simulationRate = (float)atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--displaced-terrain") == 0)
+        {
+            displacedTerrain = true;
+        }
+    }
+
+    if (simulationRate <= 0.0f)
+    {
+        std::cerr << "Invalid tick rate, using " << DEFAULT_SIMULATION_RATE << std::endl;
+        simulationRate = DEFAULT_SIMULATION_RATE;
+    }
+
+    const double simulationStep = 1.0 / simulationRate;
+
     //Set our window settings
     const int windowWidth = 1024;
     const int windowHeight = 768;
@@ -68,6 +105,7 @@ int main(int argc, char** argv)
     //programWindow.SetWindow(gWindow);
     //The example OpenGL code
     Example example(&programWindow);
+    example.getWorld()->setTerrainDisplaced(displacedTerrain);
     
     //Attach our example to our window
     programWindow.attachExample(&example);
@@ -77,27 +115,57 @@ int main(int argc, char** argv)
         programWindow.destroy(); //Reset the display and exit
         return 1;
     }
-     double lastTime = glfwGetTime();
-    
+    double lastTime = glfwGetTime();
+    double accumulator = 0.0;
+    bool traceKeyWasDown = false;
+
     //This is the mainloop, we render frames until isRunning returns false
     while(!glfwWindowShouldClose(programWindow.GetWindow()))
     {
         glfwPollEvents();
-        
-        //this might be duped
-        programWindow.processEvents();
-        
+
         double thisTime = glfwGetTime();
-        //Update((float)(thisTime - lastTime));
-        example.prepare((float)(thisTime - lastTime));
+        double frameTime = thisTime - lastTime;
         lastTime = thisTime;
 
-        // example.prepare(elapsedTime); //Do any pre-rendering logic
-        example.render(); //Render the scene
-     
-        
-         glfwSwapBuffers(programWindow.GetWindow());
-        
+        accumulator += frameTime;
+
+        //Run as many fixed steps as the time we've built up covers
+        int steps = 0;
+        while (accumulator >= simulationStep && steps < MAX_STEPS_PER_FRAME)
+        {
+            //Each step sees its own keyboard state so presses aren't missed or repeated
+            programWindow.processEvents();
+            example.prepare((float)simulationStep);
+
+            accumulator -= simulationStep;
+            ++steps;
+        }
+
+        if (steps == MAX_STEPS_PER_FRAME && accumulator >= simulationStep)
+        {
+            //We can't keep up, let the game slow down instead
+            accumulator = fmod(accumulator, simulationStep);
+        }
+
+        example.updateFPS((float)frameTime);
+
+        //Draw the entities part way between the last two steps
+        example.render((float)(accumulator / simulationStep));
+
+        {
+            PROFILE_ZONE("glfwSwapBuffers");
+            glfwSwapBuffers(programWindow.GetWindow());
+        }
+
+        //F12 saves everything the profiler has recorded so far
+        bool traceKeyDown = (glfwGetKey(programWindow.GetWindow(), GLFW_KEY_F12) == GLFW_PRESS);
+        if (traceKeyDown && !traceKeyWasDown)
+        {
+            Profiler::get().writeChromeTrace(TRACE_FILENAME);
+        }
+        traceKeyWasDown = traceKeyDown;
+
         //exit program if escape key is pressed
         if(glfwGetKey(programWindow.GetWindow(), GLFW_KEY_ESCAPE))
             glfwSetWindowShouldClose(programWindow.GetWindow(), GL_TRUE);
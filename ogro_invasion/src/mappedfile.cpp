@@ -0,0 +1,106 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+
+#include "mappedfile.h"
+
+MappedFile::MappedFile():
+#ifdef _WIN32
+m_file(INVALID_HANDLE_VALUE),
+m_mapping(NULL),
+#else
+m_file(-1),
+#endif
+m_data(NULL),
+m_size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+
+#ifdef _WIN32
+    m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        std::cerr << "Could not open " << filename << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(m_file, &size);
+    m_size = (size_t)size.QuadPart;
+
+    if (m_size > 0)
+    {
+        m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_mapping)
+        {
+            m_data = (const unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        }
+    }
+#else
+    m_file = ::open(filename.c_str(), O_RDONLY);
+    if (m_file < 0)
+    {
+        std::cerr << "Could not open " << filename << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    fstat(m_file, &info);
+    m_size = (size_t)info.st_size;
+
+    if (m_size > 0)
+    {
+        void* data = mmap(NULL, m_size, PROT_READ, MAP_SHARED, m_file, 0);
+        if (data != MAP_FAILED)
+        {
+            m_data = (const unsigned char*)data;
+        }
+    }
+#endif
+
+    if (!m_data)
+    {
+        std::cerr << "Could not map " << filename << " into memory" << std::endl;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = NULL;
+#else
+    if (m_data) munmap((void*)m_data, m_size);
+    if (m_file >= 0) ::close(m_file);
+
+    m_file = -1;
+#endif
+
+    m_data = NULL;
+    m_size = 0;
+}
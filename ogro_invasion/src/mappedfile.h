@@ -0,0 +1,44 @@
+#ifndef MAPPEDFILE_H_INCLUDED
+#define MAPPEDFILE_H_INCLUDED
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <string>
+#include <cstddef>
+
+#include "uncopyable.h"
+
+/**
+    A read only view of a whole file mapped into memory. Nothing is read
+    up front, the OS pages the file in as it is touched and can drop the
+    pages again when memory is short, so it works for files bigger than
+    we would want to load.
+*/
+class MappedFile : private Uncopyable
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const std::string& filename);
+    void close();
+
+    bool isOpen() const { return m_data != NULL; }
+    const unsigned char* getData() const { return m_data; }
+    size_t getSize() const { return m_size; }
+
+private:
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_file;
+#endif
+
+    const unsigned char* m_data;
+    size_t m_size;
+};
+
+#endif // MAPPEDFILE_H_INCLUDED
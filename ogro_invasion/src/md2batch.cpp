@@ -0,0 +1,166 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <iostream>
+#include <cstddef>
+
+#include "md2batch.h"
+#include "md2model.h"
+#include "glslshader.h"
+#include "assetmanager.h"
+
+using std::vector;
+
+const string INSTANCED_VERTEX_SHADER = "data/shaders/glsl1.30/model_instanced.vert";
+const string INSTANCED_FRAGMENT_SHADER = "data/shaders/glsl1.30/model.frag";
+
+MD2Batch::MD2Batch(AssetManager* assets, const MD2Mesh* mesh, GLuint textureID):
+m_assets(assets),
+m_mesh(mesh),
+m_textureID(textureID),
+m_keyFrameTexture(0),
+m_instanceBuffer(0),
+m_shaderProgram(NULL)
+{
+}
+
+MD2Batch::~MD2Batch()
+{
+    glDeleteTextures(1, &m_keyFrameTexture);
+    glDeleteBuffers(1, &m_instanceBuffer);
+
+    if (m_shaderProgram)
+    {
+        m_assets->releaseShader(m_shaderProgram);
+    }
+}
+
+bool MD2Batch::isSupported()
+{
+    return GLEW_VERSION_3_3 && GLSLProgram::glsl130Supported();
+}
+
+bool MD2Batch::initialize()
+{
+    m_shaderProgram = m_assets->acquireShader(INSTANCED_VERTEX_SHADER, INSTANCED_FRAGMENT_SHADER);
+    if (!m_shaderProgram)
+    {
+        std::cerr << "Could not load the instanced model shaders" << std::endl;
+        return false;
+    }
+
+    m_shaderProgram->bindAttrib(1, "a_TexCoord0");
+    m_shaderProgram->bindAttrib(3, "a_Transform");
+    m_shaderProgram->bindAttrib(4, "a_Frames");
+    m_shaderProgram->linkProgram();
+    m_shaderProgram->bindShader();
+    m_shaderProgram->sendUniform("texture0", 0);
+    m_shaderProgram->sendUniform("keyframes", 1);
+
+    generateKeyFrameTexture();
+
+    glGenBuffers(1, &m_instanceBuffer);
+    return true;
+}
+
+/**
+    Packs every key frame, one after another, into the rows of a float
+    texture. Vertex v of frame f lives at texel (f * vertexCount + v)
+    counting left to right, top to bottom.
+*/
+void MD2Batch::generateKeyFrameTexture()
+{
+    const int vertexCount = (int)m_mesh->getVertexCount();
+    const int texelCount = vertexCount * m_mesh->getFrameCount();
+    const int height = (texelCount + KEY_FRAME_TEXTURE_WIDTH - 1) / KEY_FRAME_TEXTURE_WIDTH;
+
+    vector<float> texels(KEY_FRAME_TEXTURE_WIDTH * height * 3, 0.0f);
+    int i = 0;
+    for (int frame = 0; frame < m_mesh->getFrameCount(); ++frame)
+    {
+        const vector<Vertex>& vertices = m_mesh->getFrameVertices(frame);
+        for (vector<Vertex>::const_iterator vertex = vertices.begin(); vertex != vertices.end(); ++vertex)
+        {
+            texels[i++] = (*vertex).x;
+            texels[i++] = (*vertex).y;
+            texels[i++] = (*vertex).z;
+        }
+    }
+
+    glGenTextures(1, &m_keyFrameTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_keyFrameTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, KEY_FRAME_TEXTURE_WIDTH, height, 0,
+                 GL_RGB, GL_FLOAT, &texels[0]);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void MD2Batch::clear()
+{
+    m_instances.clear();
+}
+
+void MD2Batch::addInstance(const Vector3& position, float yaw, const MD2Model& model)
+{
+    Instance instance;
+    instance.x = position.x;
+    instance.y = position.y;
+    instance.z = position.z;
+    instance.yaw = yaw;
+    instance.currentFrame = (float)model.getCurrentFrame();
+    instance.nextFrame = (float)model.getNextFrame();
+    instance.interpolation = model.getInterpolation();
+
+    m_instances.push_back(instance);
+}
+
+void MD2Batch::render(const float* modelview) const
+{
+    if (m_instances.empty())
+    {
+        return;
+    }
+
+    float project[16] = {1.53,0,0,0,0,2.05,0,0,0,0,-1.004,-1,0,0,-.2,0};
+
+    m_shaderProgram->bindShader();
+    m_shaderProgram->sendUniform4x4("modelview_matrix", modelview);
+    m_shaderProgram->sendUniform4x4("projection_matrix", project);
+    m_shaderProgram->sendUniform("vertex_count", (int)m_mesh->getVertexCount());
+    m_shaderProgram->sendUniform("keyframe_width", KEY_FRAME_TEXTURE_WIDTH);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_keyFrameTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_textureID);
+
+    //Orphan last frame's data rather than waiting for the GPU to finish with it
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Instance) * m_instances.size(), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Instance) * m_instances.size(), &m_instances[0]);
+
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(3);
+    glEnableVertexAttribArray(4);
+
+    glVertexAttribPointer((GLint)3, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (const GLvoid*)offsetof(Instance, x));
+    glVertexAttribPointer((GLint)4, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), (const GLvoid*)offsetof(Instance, currentFrame));
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribDivisor(4, 1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_mesh->getTexCoordBuffer());
+    glVertexAttribPointer((GLint)1, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+    glDrawArraysInstanced(GL_TRIANGLES, 0, m_mesh->getVertexCount(), m_instances.size());
+
+    //Everything else shares the VAO, so put the divisors back
+    glVertexAttribDivisor(3, 0);
+    glVertexAttribDivisor(4, 0);
+
+    glDisableVertexAttribArray(4);
+    glDisableVertexAttribArray(3);
+    glDisableVertexAttribArray(1);
+}
@@ -0,0 +1,66 @@
+#ifndef MD2BATCH_H_INCLUDED
+#define MD2BATCH_H_INCLUDED
+
+#include <vector>
+#include <GL/Glew.h>
+
+#include "geom.h"
+#include "uncopyable.h"
+
+class MD2Mesh;
+class MD2Model;
+class GLSLProgram;
+class AssetManager;
+
+/**
+    Draws every instance of an MD2 mesh with a single glDrawArraysInstanced.
+
+    The key frames are copied into a float texture once, and each frame the
+    instances are gathered into a per-instance buffer holding the position,
+    yaw, the pair of key frames and the blend factor. The vertex shader
+    fetches and blends the two key frames itself, so the number of draw
+    calls doesn't change no matter how many instances there are.
+
+    The batch doesn't own the mesh, it must not outlive the models that
+    reference it.
+*/
+class MD2Batch : private Uncopyable
+{
+public:
+    MD2Batch(AssetManager* assets, const MD2Mesh* mesh, GLuint textureID);
+    virtual ~MD2Batch();
+
+    bool initialize();
+
+    void clear();
+    void addInstance(const Vector3& position, float yaw, const MD2Model& model);
+    void render(const float* modelview) const;
+
+    unsigned int getInstanceCount() const { return m_instances.size(); }
+
+    //Instancing needs GL 3.3 (attribute divisors) and GLSL 1.30 (texelFetch/gl_VertexID)
+    static bool isSupported();
+
+private:
+    struct Instance
+    {
+        float x, y, z, yaw;
+        float currentFrame, nextFrame, interpolation;
+    };
+
+    void generateKeyFrameTexture();
+
+    static const int KEY_FRAME_TEXTURE_WIDTH = 1024;
+
+    AssetManager* m_assets;
+    const MD2Mesh* m_mesh;
+    GLuint m_textureID;
+
+    GLuint m_keyFrameTexture;
+    GLuint m_instanceBuffer;
+    GLSLProgram* m_shaderProgram;
+
+    std::vector<Instance> m_instances;
+};
+
+#endif // MD2BATCH_H_INCLUDED
@@ -7,6 +7,7 @@
 
 #include "glslshader.h"
 #include "md2model.h"
+#include "assetmanager.h"
 
 using std::ifstream;
 using std::string;
@@ -34,24 +35,30 @@ const Animation Animation::DEATH1 = Animation(178, 183, false);
 const Animation Animation::DEATH2 = Animation(184, 189, false);
 const Animation Animation::DEATH3 = Animation(190, 197, false);
 
-MD2Model::MD2Model(const std::string vertexShader, const std::string fragmentShader):
-m_currentFrame(0),
-m_nextFrame(1),
-m_startFrame(0),
-m_endFrame(0),
-m_interpolation(0.0f),
+MD2Mesh::MD2Mesh():
+m_vertexCount(0),
+m_vertexBuffer(0),
+m_keyFrameBuffer(0),
+m_texCoordBuffer(0),
 m_shaderProgram(NULL)
 {
-    m_shaderProgram = new GLSLProgram(vertexShader, fragmentShader);
 }
 
-MD2Model::~MD2Model()
+MD2Mesh::~MD2Mesh()
 {
-    delete m_shaderProgram;
+    //Meshes loaded without a shader never created any buffers
+    if (m_shaderProgram)
+    {
+        glDeleteBuffers(1, &m_vertexBuffer);
+        glDeleteBuffers(1, &m_keyFrameBuffer);
+        glDeleteBuffers(1, &m_texCoordBuffer);
+    }
 }
 
-bool MD2Model::load(const string& filename)
+bool MD2Mesh::load(const string& filename, GLSLProgram* shaderProgram)
 {
+    m_shaderProgram = shaderProgram;
+
     ifstream fileIn(filename.c_str(), std::ios::binary);
 
     if (!fileIn.good()) {
@@ -153,36 +160,75 @@ bool MD2Model::load(const string& filename)
     reorganizeVertices();
     stripTextureNames();
 
-    //The current frame is the interpolated frame being rendered
-    //it will usually be midway between 2 frames of animation
-    m_interpolatedFrame.vertices = m_keyFrames[0].vertices;
-
-    generateBuffers();
+    m_vertexCount = m_keyFrames[0].vertices.size();
 
-    if (!m_shaderProgram->initialize())
+    if (!m_shaderProgram)
     {
-        std::cerr << "Could not load the shaders for the MD2 model" << std::endl;
-        return false;
+        return true; //CPU side only, nothing will draw this mesh
     }
 
+    generateBuffers();
+
     m_shaderProgram->bindAttrib(0, "a_Vertex");
     m_shaderProgram->bindAttrib(1, "a_TexCoord0");
+    m_shaderProgram->bindAttrib(2, "a_NextVertex");
     m_shaderProgram->linkProgram();
 
     return true;
 }
 
 
-void MD2Model::generateBuffers() {
+void MD2Mesh::generateBuffers() {
     glGenBuffers(1, &m_vertexBuffer);
     glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * m_interpolatedFrame.vertices.size(), &m_interpolatedFrame.vertices[0], GL_DYNAMIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * m_vertexCount, &m_keyFrames[0].vertices[0], GL_DYNAMIC_DRAW);
+
+    //Lay all of the key frames out back to back, frame N starts N * m_vertexCount vertices in
+    const GLsizeiptr frameSize = sizeof(float) * 3 * m_vertexCount;
+
+    glGenBuffers(1, &m_keyFrameBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_keyFrameBuffer);
+    glBufferData(GL_ARRAY_BUFFER, frameSize * m_keyFrames.size(), NULL, GL_STATIC_DRAW);
+    for (unsigned int i = 0; i < m_keyFrames.size(); ++i)
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, frameSize * i, frameSize, &m_keyFrames[i].vertices[0]);
+    }
 
     glGenBuffers(1, &m_texCoordBuffer);
     glBindBuffer(GL_ARRAY_BUFFER, m_texCoordBuffer);
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 2 * m_texCoords.size(), &m_texCoords[0], GL_STATIC_DRAW);
 }
 
+MD2Model::MD2Model():
+m_assets(NULL),
+m_mesh(NULL),
+m_startFrame(0),
+m_endFrame(0),
+m_currentFrame(0),
+m_nextFrame(1),
+m_interpolation(0.0f),
+m_loopAnimation(true),
+m_interpolationMode(GPU_INTERPOLATION)
+{
+}
+
+MD2Model::~MD2Model()
+{
+    if (m_mesh)
+    {
+        m_assets->releaseModel(m_mesh);
+    }
+}
+
+bool MD2Model::load(AssetManager* assets, const string& filename,
+                    const string& vertexShader, const string& fragmentShader)
+{
+    m_assets = assets;
+    m_mesh = m_assets->acquireModel(filename, vertexShader, fragmentShader);
+
+    return (m_mesh != NULL);
+}
+
 void MD2Model::update(float dt)
 {
     const float FRAMES_PER_SECOND = 8.0f;
@@ -204,58 +250,92 @@ void MD2Model::update(float dt)
         m_interpolation = 0.0f;
     }
 
+    if (m_interpolationMode == GPU_INTERPOLATION)
+    {
+        return; //The vertex shader does the rest
+    }
+
+    //The interpolated frame is the one being rendered, it will usually
+    //be midway between 2 frames of animation
+    if (m_interpolatedFrame.empty())
+    {
+        m_interpolatedFrame = m_mesh->getFrameVertices(m_currentFrame);
+    }
+
+    const vector<Vertex>& currentFrame = m_mesh->getFrameVertices(m_currentFrame);
+    const vector<Vertex>& nextFrame = m_mesh->getFrameVertices(m_nextFrame);
+
     float t = m_interpolation;
     int i = 0;
-    for (vector<Vertex>::iterator vertex = m_interpolatedFrame.vertices.begin();
-        vertex != m_interpolatedFrame.vertices.end(); ++vertex) {
+    for (vector<Vertex>::iterator vertex = m_interpolatedFrame.begin();
+        vertex != m_interpolatedFrame.end(); ++vertex) {
 
-	    float x1 = m_keyFrames[m_currentFrame].vertices[i].x;
-	    float x2 = m_keyFrames[m_nextFrame].vertices[i].x;
+	    float x1 = currentFrame[i].x;
+	    float x2 = nextFrame[i].x;
 	    (*vertex).x = x1 + t * (x2 - x1);
 
-	    float y1 = m_keyFrames[m_currentFrame].vertices[i].y;
-	    float y2 = m_keyFrames[m_nextFrame].vertices[i].y;
+	    float y1 = currentFrame[i].y;
+	    float y2 = nextFrame[i].y;
 	    (*vertex).y = y1 + t * (y2 - y1);
 
-	    float z1 = m_keyFrames[m_currentFrame].vertices[i].z;
-	    float z2 = m_keyFrames[m_nextFrame].vertices[i].z;
+	    float z1 = currentFrame[i].z;
+	    float z2 = nextFrame[i].z;
 	    (*vertex).z = z1 + t * (z2 - z1);
 
         ++i;
     }
-
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * 3 * m_interpolatedFrame.vertices.size(), &m_interpolatedFrame.vertices[0]);
 }
 
 void MD2Model::render(float mvp[])
 {
-    static float modelviewMatrix[16];
-    static float projectionMatrix[16];
-
-    glGetFloatv(GL_MODELVIEW_MATRIX, modelviewMatrix);
-    glGetFloatv(GL_PROJECTION_MATRIX, projectionMatrix);
-    
     float project[16] = {1.53,0,0,0,0,2.05,0,0,0,0,-1.004,-1,0,0,-.2,0};
-    
-    m_shaderProgram->bindShader();
-    m_shaderProgram->sendUniform4x4("modelview_matrix", mvp);
-    m_shaderProgram->sendUniform4x4("projection_matrix", project);
-    m_shaderProgram->sendUniform("texture0", 0);
 
-    //glBindTexture(GL_TEXTURE_2D, m_treeTexID);
+    GLSLProgram* shaderProgram = m_mesh->getShaderProgram();
+    shaderProgram->bindShader();
+    shaderProgram->sendUniform4x4("modelview_matrix", mvp);
+    shaderProgram->sendUniform4x4("projection_matrix", project);
+    shaderProgram->sendUniform("texture0", 0);
 
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-    glVertexAttribPointer((GLint)0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    if (m_interpolationMode == GPU_INTERPOLATION)
+    {
+        //Point the two position attributes at the current and next key frames
+        const GLsizeiptr frameSize = sizeof(float) * 3 * m_mesh->getVertexCount();
+        const GLvoid* currentOffset = (const GLvoid*)(frameSize * m_currentFrame);
+        const GLvoid* nextOffset = (const GLvoid*)(frameSize * m_nextFrame);
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_texCoordBuffer);
+        shaderProgram->sendUniform("interpolation", m_interpolation);
+
+        glBindBuffer(GL_ARRAY_BUFFER, m_mesh->getKeyFrameBuffer());
+        glVertexAttribPointer((GLint)0, 3, GL_FLOAT, GL_FALSE, 0, currentOffset);
+        glVertexAttribPointer((GLint)2, 3, GL_FLOAT, GL_FALSE, 0, nextOffset);
+    }
+    else
+    {
+        //The vertex buffer is shared between all the instances of the mesh,
+        //so this instance's frame is uploaded just before it is drawn
+        shaderProgram->sendUniform("interpolation", 0.0f);
+
+        if (m_interpolatedFrame.empty())
+        {
+            m_interpolatedFrame = m_mesh->getFrameVertices(m_currentFrame);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, m_mesh->getVertexBuffer());
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * 3 * m_interpolatedFrame.size(), &m_interpolatedFrame[0]);
+        glVertexAttribPointer((GLint)0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glVertexAttribPointer((GLint)2, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_mesh->getTexCoordBuffer());
     glVertexAttribPointer((GLint)1, 2, GL_FLOAT, GL_FALSE, 0, 0);
 
-    glDrawArrays(GL_TRIANGLES, 0, m_interpolatedFrame.vertices.size());
+    glDrawArrays(GL_TRIANGLES, 0, m_mesh->getVertexCount());
 
+    glDisableVertexAttribArray(2);
     glDisableVertexAttribArray(1);
     glDisableVertexAttribArray(0);
 }
@@ -270,7 +350,7 @@ To fix this we go through each frame, duplicating some vertices
 and removing the need to use indices. The texture coordinates
 are inserted to match the vertices. */
 
-void MD2Model::reorganizeVertices() {
+void MD2Mesh::reorganizeVertices() {
     //Go through each frame
     vector<Vertex> tempVertices;
     vector<TexCoord> tempTexCoords;
@@ -306,7 +386,7 @@ void MD2Model::reorganizeVertices() {
     MD2 models can have multiple "skins". These are PCX images and tend to live in the folders
     that Quake 2 stored them in like players/blah/something.pcx. We
 */
-void MD2Model::stripTextureNames()
+void MD2Mesh::stripTextureNames()
 {
     for(vector<Skin>::iterator skin = m_skins.begin(); skin != m_skins.end(); ++skin) {
         string texture = (*skin).name;
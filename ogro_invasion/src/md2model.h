@@ -6,8 +6,10 @@
 #include <vector>
 #include <string>
 #include "geom.h"
+#include "uncopyable.h"
 
 class GLSLProgram;
+class AssetManager;
 
 struct Animation {
     int startFrame;
@@ -41,42 +43,47 @@ struct Animation {
     static const Animation DEATH3;
 };
 
-class MD2Model
+/**
+    The data loaded from an MD2 file: the key frames, texture coordinates,
+    buffers and shader. This is the same for every entity that uses the
+    model so it is loaded once by the AssetManager and shared by all
+    of the MD2Model instances.
+*/
+class MD2Mesh : private Uncopyable
 {
 public:
-    MD2Model(const std::string vertexShader, const std::string fragmentShader);
-    virtual ~MD2Model();
+    MD2Mesh();
+    virtual ~MD2Mesh();
 
-    bool load(const std::string& filename);
-    void update(float dt);
-    void render(float mvp[]);
+    //If shaderProgram is NULL the mesh is kept in system memory only and can't be rendered
+    bool load(const std::string& filename, GLSLProgram* shaderProgram);
 
-    void setAnimation(int start, int end) {
-        m_startFrame = start;
-        m_endFrame = end;
-        m_nextFrame = m_startFrame;
+    std::vector<std::string> getSkinNames() const {
+        return m_textureNames;
     }
 
-    void setAnimation(const Animation& ani) {
-        setAnimation(ani.startFrame, ani.endFrame);
-        m_loopAnimation = ani.loop;
+    const std::vector<Vertex>& getFrameVertices(int frame) const {
+        return m_keyFrames[frame].vertices;
     }
 
-    std::vector<std::string> getSkinNames() {
-        return m_textureNames;
-    }
+    int getFrameCount() const { return (int)m_keyFrames.size(); }
+    unsigned int getVertexCount() const { return m_vertexCount; }
 
-    float getRadius()
+    float getRadius(int frame) const
     {
-        if (m_currentFrame < 0 || m_currentFrame > (int) m_radii.size())
+        if (frame < 0 || frame >= (int) m_radii.size())
         {
             return m_radii[0];
         }
-        return m_radii[m_currentFrame]; //Return the current radius
+        return m_radii[frame];
     }
 
-private:
+    GLSLProgram* getShaderProgram() const { return m_shaderProgram; }
+    GLuint getVertexBuffer() const { return m_vertexBuffer; }
+    GLuint getKeyFrameBuffer() const { return m_keyFrameBuffer; }
+    GLuint getTexCoordBuffer() const { return m_texCoordBuffer; }
 
+private:
     void reorganizeVertices();
     void stripTextureNames();
 
@@ -140,7 +147,76 @@ private:
     std::vector<KeyFrame> m_keyFrames;
     std::vector<std::string> m_textureNames;
 
-    KeyFrame m_interpolatedFrame;
+    unsigned int m_vertexCount;
+
+    GLuint m_vertexBuffer; //Shared by all instances, filled with the interpolated frame before each draw
+    GLuint m_keyFrameBuffer; //Every key frame, one after the other, uploaded once
+    GLuint m_texCoordBuffer;
+
+    GLSLProgram* m_shaderProgram; //Owned by the AssetManager
+
+    std::vector<float> m_radii; //Store the radius for each frame
+};
+
+/**
+    An animated instance of an MD2Mesh. This only holds the animation
+    state, everything loaded from disk lives in the shared mesh.
+*/
+class MD2Model : private Uncopyable
+{
+public:
+    /**
+        With GPU interpolation the two key frames are read straight out of
+        the mesh's static key frame buffer and blended in the vertex shader,
+        so an update is just a few counters and nothing is uploaded.
+        CPU interpolation blends every vertex here and re-sends the frame.
+    */
+    enum InterpolationMode {
+        CPU_INTERPOLATION,
+        GPU_INTERPOLATION
+    };
+
+    MD2Model();
+    virtual ~MD2Model();
+
+    bool load(AssetManager* assets, const std::string& filename,
+              const std::string& vertexShader, const std::string& fragmentShader);
+    void update(float dt);
+    void render(float mvp[]);
+
+    void setAnimation(int start, int end) {
+        m_startFrame = start;
+        m_endFrame = end;
+        m_nextFrame = m_startFrame;
+    }
+
+    void setAnimation(const Animation& ani) {
+        setAnimation(ani.startFrame, ani.endFrame);
+        m_loopAnimation = ani.loop;
+    }
+
+    std::vector<std::string> getSkinNames() {
+        return m_mesh->getSkinNames();
+    }
+
+    const MD2Mesh* getMesh() const { return m_mesh; }
+    int getCurrentFrame() const { return m_currentFrame; }
+    int getNextFrame() const { return m_nextFrame; }
+    float getInterpolation() const { return m_interpolation; }
+
+    void setInterpolationMode(InterpolationMode mode) { m_interpolationMode = mode; }
+    InterpolationMode getInterpolationMode() const { return m_interpolationMode; }
+
+    float getRadius()
+    {
+        return m_mesh->getRadius(m_currentFrame); //Return the current radius
+    }
+
+private:
+    AssetManager* m_assets;
+    const MD2Mesh* m_mesh;
+
+    std::vector<Vertex> m_interpolatedFrame;
 
     int m_startFrame;
     int m_endFrame;
@@ -149,12 +225,7 @@ private:
     float m_interpolation;
     bool m_loopAnimation;
 
-    GLuint m_vertexBuffer;
-    GLuint m_texCoordBuffer;
-
-    GLSLProgram* m_shaderProgram;
-
-    std::vector<float> m_radii; //Store the radius for each frame
+    InterpolationMode m_interpolationMode;
 };
 
 #endif
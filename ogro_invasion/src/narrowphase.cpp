@@ -0,0 +1,141 @@
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NARROWPHASE_USE_SSE2
+#endif
+
+#include "narrowphase.h"
+#include "entitystore.h"
+
+using std::vector;
+
+Narrowphase::Narrowphase()
+{
+}
+
+void Narrowphase::clear()
+{
+    m_firsts.clear();
+    m_seconds.clear();
+    m_orders.clear();
+    m_overlaps.clear();
+    m_earlyContacts.clear();
+    m_addedContacts.clear();
+    m_sphereContacts.clear();
+    m_contacts.clear();
+}
+
+void Narrowphase::addSpherePair(unsigned int first, unsigned int second, unsigned int order)
+{
+    m_firsts.push_back(first);
+    m_seconds.push_back(second);
+    m_orders.push_back(order);
+}
+
+void Narrowphase::addContact(Collider* first, Collider* second, float timeOfImpact, unsigned int order)
+{
+    Contact contact;
+    contact.first = first;
+    contact.second = second;
+    contact.timeOfImpact = timeOfImpact;
+    contact.order = order;
+
+    if (timeOfImpact < 1.0f)
+    {
+        m_earlyContacts.push_back(contact);
+    }
+    else
+    {
+        m_addedContacts.push_back(contact);
+    }
+}
+
+const vector<Narrowphase::Contact>& Narrowphase::findContacts(const EntityStore& entities)
+{
+    if (!m_firsts.empty())
+    {
+        findOverlaps(entities.getXs(), entities.getYs(), entities.getZs(), entities.getRadii());
+    }
+
+    //Overlapping spheres are found touching at the end of the step
+    for (vector<unsigned int>::const_iterator pair = m_overlaps.begin(); pair != m_overlaps.end(); ++pair)
+    {
+        Contact contact;
+        contact.first = entities.getCollider(m_firsts[*pair]);
+        contact.second = entities.getCollider(m_seconds[*pair]);
+        contact.timeOfImpact = 1.0f;
+        contact.order = m_orders[*pair];
+        m_sphereContacts.push_back(contact);
+    }
+
+    std::sort(m_earlyContacts.begin(), m_earlyContacts.end());
+
+    m_contacts.assign(m_earlyContacts.begin(), m_earlyContacts.end());
+    m_contacts.resize(m_earlyContacts.size() + m_addedContacts.size() + m_sphereContacts.size());
+    std::merge(m_addedContacts.begin(), m_addedContacts.end(), m_sphereContacts.begin(), m_sphereContacts.end(),
+               m_contacts.begin() + m_earlyContacts.size());
+
+    return m_contacts;
+}
+
+/**
+    Two spheres overlap if the distance between their centres is no more
+    than their radii added together. Squaring both sides saves a square
+    root per pair. The SSE version does the same sums in the same order
+    so they both find the same pairs.
+*/
+void Narrowphase::findOverlaps(const float* xs, const float* ys, const float* zs, const float* radii)
+{
+    const unsigned int count = m_firsts.size();
+    const unsigned int* firsts = &m_firsts[0];
+    const unsigned int* seconds = &m_seconds[0];
+
+    unsigned int i = 0;
+
+#ifdef NARROWPHASE_USE_SSE2
+    for (; i + 4 <= count; i += 4)
+    {
+        const unsigned int* a = firsts + i;
+        const unsigned int* b = seconds + i;
+
+        //The pairs are scattered through the store, so gather them a lane at a time
+        __m128 dx = _mm_sub_ps(_mm_set_ps(xs[a[3]], xs[a[2]], xs[a[1]], xs[a[0]]),
+                               _mm_set_ps(xs[b[3]], xs[b[2]], xs[b[1]], xs[b[0]]));
+        __m128 dy = _mm_sub_ps(_mm_set_ps(ys[a[3]], ys[a[2]], ys[a[1]], ys[a[0]]),
+                               _mm_set_ps(ys[b[3]], ys[b[2]], ys[b[1]], ys[b[0]]));
+        __m128 dz = _mm_sub_ps(_mm_set_ps(zs[a[3]], zs[a[2]], zs[a[1]], zs[a[0]]),
+                               _mm_set_ps(zs[b[3]], zs[b[2]], zs[b[1]], zs[b[0]]));
+        __m128 reach = _mm_add_ps(_mm_set_ps(radii[a[3]], radii[a[2]], radii[a[1]], radii[a[0]]),
+                                  _mm_set_ps(radii[b[3]], radii[b[2]], radii[b[1]], radii[b[0]]));
+
+        __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        int touching = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_mul_ps(reach, reach)));
+
+        //Most pairs from the grid don't touch, so usually there's nothing to add
+        for (unsigned int lane = 0; touching != 0; ++lane, touching >>= 1)
+        {
+            if (touching & 1)
+            {
+                m_overlaps.push_back(i + lane);
+            }
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        unsigned int a = firsts[i];
+        unsigned int b = seconds[i];
+
+        float dx = xs[a] - xs[b];
+        float dy = ys[a] - ys[b];
+        float dz = zs[a] - zs[b];
+        float reach = radii[a] + radii[b];
+
+        if ((dx * dx + dy * dy) + dz * dz <= reach * reach)
+        {
+            m_overlaps.push_back(i);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef NARROWPHASE_H_INCLUDED
+#define NARROWPHASE_H_INCLUDED
+
+#include <vector>
+
+#include "uncopyable.h"
+
+class Collider;
+class EntityStore;
+
+/**
+    Turns the broadphase's candidate pairs into the list of contacts for
+    a frame. Most pairs are two plain spheres (ogros, trees, the player)
+    and only need their overlap checking, those are queued up and tested
+    together straight from the entity store's position and radius arrays,
+    four pairs at a time where SSE2 is available. Nothing is looked up
+    through the colliders or entities for them. Anything else (the
+    terrain, swept rockets) is tested by its collider and added as a
+    contact directly.
+
+    Contacts come out in time of impact order. Contacts at the same time
+    keep the order their pairs came out of the broadphase. Almost every
+    contact is at the end of the step, so only the few earlier ones (from
+    swept colliders) are sorted, the rest are already in order and are
+    merged.
+*/
+class Narrowphase : private Uncopyable
+{
+public:
+    struct Contact
+    {
+        Collider* first;
+        Collider* second;
+        float timeOfImpact;
+        unsigned int order; //Where the pair was in the broadphase's list
+
+        bool operator<(const Contact& rhs) const
+        {
+            if (timeOfImpact != rhs.timeOfImpact)
+            {
+                return timeOfImpact < rhs.timeOfImpact;
+            }
+            return order < rhs.order;
+        }
+    };
+
+    Narrowphase();
+
+    void clear();
+
+    //first and second are indices into the entity store
+    void addSpherePair(unsigned int first, unsigned int second, unsigned int order);
+    void addContact(Collider* first, Collider* second, float timeOfImpact, unsigned int order);
+
+    /**
+        Tests the queued sphere pairs, adds a contact for each one that
+        overlaps and sorts everything. The store must hold the positions
+        and radii the pairs were found with. The returned vector is reused
+        so it is only valid until the next clear().
+    */
+    const std::vector<Contact>& findContacts(const EntityStore& entities);
+
+private:
+    void findOverlaps(const float* xs, const float* ys, const float* zs, const float* radii);
+
+    //The queued sphere pairs, one entry per pair in each
+    std::vector<unsigned int> m_firsts;
+    std::vector<unsigned int> m_seconds;
+    std::vector<unsigned int> m_orders;
+
+    std::vector<unsigned int> m_overlaps; //Queued pairs that touch, in the order they were queued
+
+    std::vector<Contact> m_earlyContacts; //Before the end of the step
+    std::vector<Contact> m_addedContacts; //At the end of the step, in order
+    std::vector<Contact> m_sphereContacts; //From the queued pairs, in order
+    std::vector<Contact> m_contacts; //Everything, in order
+};
+
+#endif // NARROWPHASE_H_INCLUDED
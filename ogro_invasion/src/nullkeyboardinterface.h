@@ -0,0 +1,22 @@
+#ifndef NULLKEYBOARDINTERFACE_H_INCLUDED
+#define NULLKEYBOARDINTERFACE_H_INCLUDED
+
+#include "uncopyable.h"
+#include "keyboardinterface.h"
+
+/**
+    A keyboard that nobody is typing on, for running the game
+    without a window.
+*/
+class NullKeyboardInterface : public KeyboardInterface {
+public:
+    virtual bool isKeyPressed(BOGLGPKeyCode code) { return false; }
+    virtual bool isKeyHeldDown(BOGLGPKeyCode code) { return false; }
+
+    virtual void handleKeyDown(BOGLGPKeyCode code) { }
+    virtual void handleKeyUp(BOGLGPKeyCode code) { }
+    virtual BOGLGPKeyCode translateKey(unsigned int code) { return KC_INVALID; }
+    virtual void update() { }
+};
+
+#endif // NULLKEYBOARDINTERFACE_H_INCLUDED
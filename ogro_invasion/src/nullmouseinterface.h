@@ -0,0 +1,40 @@
+#ifndef NULLMOUSEINTERFACE_H_INCLUDED
+#define NULLMOUSEINTERFACE_H_INCLUDED
+
+#include "mouseinterface.h"
+
+/**
+    A mouse that never moves or clicks. It stays wherever the
+    game last put it so the player doesn't turn.
+*/
+class NullMouseInterface : public MouseInterface
+{
+public:
+    NullMouseInterface():
+    m_x(0),
+    m_y(0)
+    {
+    }
+
+    virtual void getMousePos(int& x, int& y)
+    {
+        x = m_x;
+        y = m_y;
+    }
+
+    virtual void setMousePos(int x, int y)
+    {
+        m_x = x;
+        m_y = y;
+    }
+
+    virtual void showCursor(bool val) { }
+    virtual bool isButtonPressed(int button) { return false; }
+    virtual void toggleMousebutton(int button, bool pressed) { }
+    virtual void update() { }
+
+private:
+    int m_x, m_y;
+};
+
+#endif // NULLMOUSEINTERFACE_H_INCLUDED
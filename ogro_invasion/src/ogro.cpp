@@ -16,6 +16,7 @@
 #include "gameworld.h"
 #include "player.h"
 #include "landscape.h"
+#include "assetmanager.h"
 
 using std::string;
 
@@ -24,19 +25,23 @@ const string OGRO_TEXTURE = "data/models/Ogro/Ogrobase.tga";
 
 Ogro::Ogro(GameWorld* world):
 Enemy(world),
+m_ogroTextureID(0),
 m_AIState(OGRO_IDLE),
 m_currentTime(0),
 m_lastAIChange(0)
 {
-    string vertexShader = (GLSLProgram::glsl130Supported())? "data/shaders/glsl1.30/model.vert" : "data/shaders/glsl1.20/model.vert";
-    string fragmentShader = (GLSLProgram::glsl130Supported())? "data/shaders/glsl1.30/model.frag" : "data/shaders/glsl1.20/model.frag";
-    m_model = new MD2Model(vertexShader, fragmentShader);
+    m_model = new MD2Model();
     m_model->setAnimation(Animation::IDLE);
 }
 
 Ogro::~Ogro()
 {
     delete m_model;
+
+    if (m_ogroTextureID)
+    {
+        getWorld()->getAssets()->releaseTexture(m_ogroTextureID);
+    }
 }
 
 void Ogro::onPrepare(float dT)
@@ -49,11 +54,10 @@ void Ogro::onPrepare(float dT)
 
     m_model->update(dT);
 
-    if (m_position.y > 0.0f) {
-        m_position.y -= 10.0f * dT;
-    }
-
     Vector3 pos = getPosition();
+    if (pos.y > 0.0f) {
+        pos.y -= 10.0f * dT;
+    }
 
     float speed = 0.0f;
 
@@ -66,8 +70,8 @@ void Ogro::onPrepare(float dT)
         speed = 0.5f * dT;
     }
 
-    float cosYaw = cosf(degreesToRadians(m_yaw));
-    float sinYaw = sinf(degreesToRadians(m_yaw));
+    float cosYaw = cosf(degreesToRadians(getYaw()));
+    float sinYaw = sinf(degreesToRadians(getYaw()));
     pos.x += float(cosYaw) * speed;
     pos.z += float(sinYaw) * speed;
 
@@ -82,15 +86,16 @@ void Ogro::onRender() const
     float dArray[16] = {0.0};
     glm::mat4 modelMatrix = glm::make_mat4(ptr);
     glPushMatrix();
-        Vector3 pos = getPosition();
+        Vector3 pos = getRenderPosition();
+        float yaw = getRenderYaw();
         glTranslatef(pos.x, pos.y, pos.z);
-        modelMatrix = glm::translate(modelMatrix, glm::vec3(pos.x,pos.y,pos.x));
-        modelMatrix = glm::rotate(modelMatrix,getYaw(),glm::vec3(0.0f,-1.0f,0.0f));
+        modelMatrix = glm::translate(modelMatrix, glm::vec3(pos.x,pos.y,pos.z));
+        modelMatrix = glm::rotate(modelMatrix,yaw,glm::vec3(0.0f,-1.0f,0.0f));
         const float *pSource = (const float*)glm::value_ptr(modelMatrix);
     
         for (int i = 0; i < 16; ++i)
             dArray[i] = pSource[i];
-        glRotatef(getYaw(), 0.0f, -1.0f, 0.0f);
+        glRotatef(yaw, 0.0f, -1.0f, 0.0f);
         glBindTexture(GL_TEXTURE_2D, m_ogroTextureID);
         m_model->render(dArray);
     glPopMatrix();
@@ -103,28 +108,23 @@ void Ogro::onPostRender()
 
 bool Ogro::onInitialize()
 {
-    bool result = m_model->load(OGRO_MODEL);
-    if (result)
+    //A headless world has no context to ask, its models are loaded without shaders
+    string vertexShader, fragmentShader;
+    if (!getWorld()->isHeadless())
     {
-        if (!m_ogroTexture.load(OGRO_TEXTURE))
-        {
-            result = false;
-        }
-        else
-        {
-            glGenTextures(1, &m_ogroTextureID);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, m_ogroTextureID);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-
-            gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGB8, m_ogroTexture.getWidth(),
-                              m_ogroTexture.getHeight(), GL_RGB, GL_UNSIGNED_BYTE,
-                              m_ogroTexture.getImageData());
-        }
+        vertexShader = (GLSLProgram::glsl130Supported())? "data/shaders/glsl1.30/model.vert" : "data/shaders/glsl1.20/model.vert";
+        fragmentShader = (GLSLProgram::glsl130Supported())? "data/shaders/glsl1.30/model.frag" : "data/shaders/glsl1.20/model.frag";
+    }
+
+    AssetManager* assets = getWorld()->getAssets();
+    bool result = m_model->load(assets, OGRO_MODEL, vertexShader, fragmentShader);
+    if (result && !getWorld()->isHeadless())
+    {
+        m_ogroTextureID = assets->acquireTexture(OGRO_TEXTURE);
+        result = (m_ogroTextureID != 0);
     }
 
-    m_yaw = (float(rand()) / RAND_MAX) * 360.0f;
+    setYaw((float(rand()) / RAND_MAX) * 360.0f);
     return result;
 }
 
@@ -134,9 +134,9 @@ void Ogro::onShutdown()
 }
 
 
-AIState getRandomIdleState()
+AIState getRandomIdleState(int random)
 {
-    int result = rand() % 3;
+    int result = random % 3;
     if (result == 0)
     {
         return OGRO_IDLE;
@@ -173,9 +173,9 @@ void Ogro::processAI()
 
     if (playerDistance >= DANGER_DISTANCE)
     {
-        if (((m_currentTime + float(rand() % 5) / 10.0f) - m_lastAIChange) > 8.0f)
+        if (((m_currentTime + float(random() % 5) / 10.0f) - m_lastAIChange) > 8.0f)
         {
-            AIState newState = getRandomIdleState();
+            AIState newState = getRandomIdleState(random());
             if (newState != m_AIState)
             {
                 m_AIState = newState;
@@ -187,12 +187,12 @@ void Ogro::processAI()
                 if (newState == OGRO_CROUCH)
                 {
                     m_model->setAnimation(Animation::CROUCH_IDLE);
-                    m_yaw += float(rand() % 180) - 90.0f;
+                    setYaw(getYaw() + (float(random() % 180) - 90.0f));
                 }
                 if (newState == OGRO_WALK)
                 {
                     m_model->setAnimation(Animation::CROUCH_WALK);
-                    m_yaw += float(rand() % 180) - 90.0f;
+                    setYaw(getYaw() + (float(random() % 180) - 90.0f));
                 }
             }
         }
@@ -204,34 +204,36 @@ void Ogro::processAI()
     float minZ = getWorld()->getLandscape()->getTerrain()->getMinZ() + 2.5f;
     float maxZ = getWorld()->getLandscape()->getTerrain()->getMaxZ() - 2.5f;
 
-    float randYaw = 90.0f + (float) (rand() % 90);
+    float randYaw = 90.0f + (float) (random() % 90);
 
     if (getPosition().x < minX ||
         getPosition().x > maxX ||
         getPosition().z < minZ ||
         getPosition().z > maxZ)
     {
-        m_yaw += randYaw;
+        setYaw(getYaw() + randYaw);
         m_AIState = OGRO_WALK;
         m_model->setAnimation(Animation::RUN);
         m_lastAIChange = m_currentTime;
 
-        if (getPosition().x < minX)
+        Vector3 pos = getPosition();
+        if (pos.x < minX)
         {
-            m_position.x = minX;
+            pos.x = minX;
         }
-        else if (getPosition().x > maxX)
+        else if (pos.x > maxX)
         {
-            m_position.x = maxX;
+            pos.x = maxX;
         }
-        else if (getPosition().z < minZ)
+        else if (pos.z < minZ)
         {
-            m_position.z = minZ;
+            pos.z = minZ;
         }
-        else if (getPosition().z > maxZ)
+        else if (pos.z > maxZ)
         {
-            m_position.z = maxZ;
+            pos.z = maxZ;
         }
+        setPosition(pos);
     }
 
 
@@ -254,6 +256,9 @@ void Ogro::onKill()
     }
 
     m_AIState = OGRO_DEAD;
+
+    //The body stays where it fell, but it's free to be brought back as a new ogro
+    getWorld()->releaseOgro(this);
 }
 
 void Ogro::onResurrection()
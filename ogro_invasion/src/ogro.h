@@ -2,7 +2,6 @@
 #define OGRO_H_INCLUDED
 
 #include "enemy.h"
-#include "targa.h"
 
 class MD2Model;
 
@@ -23,6 +22,9 @@ class Ogro : public Enemy
 
         virtual EntityType getType() const { return OGRO; }
 
+        const MD2Model* getModel() const { return m_model; }
+        unsigned int getTextureID() const { return m_ogroTextureID; }
+
     private:
         virtual void onPrepare(float dT);
         virtual void onRender() const;
@@ -31,8 +33,7 @@ class Ogro : public Enemy
         virtual void onShutdown();
 
         MD2Model* m_model;
-        TargaImage m_ogroTexture;
-        unsigned int m_ogroTextureID;
+        unsigned int m_ogroTextureID; //Shared between all the ogros
 
         void processAI();
 
@@ -8,10 +8,7 @@
 Player::Player(GameWorld* const world):
 Entity(world),
 m_score(0),
-m_position(Vector3()),
-m_velocity(Vector3()),
-m_yaw(0.0f),
-m_pitch(0.0f)
+m_velocity(Vector3())
 {
     m_collider = new SphereCollider(this, 0.75f);
 }
@@ -55,17 +52,20 @@ void Player::onPrepare(float dT)
     yaw(float(x) * 40.0f * dT);
     pitch(float(y)* -40.0f * dT);
 
-    m_position.y -= 8.0f * dT;
+    Vector3 position = getPosition();
+    position.y -= 8.0f * dT;
 
     float minX = getWorld()->getLandscape()->getTerrain()->getMinX() + 2.5f;
     float maxX = getWorld()->getLandscape()->getTerrain()->getMaxX() - 2.5f;
     float minZ = getWorld()->getLandscape()->getTerrain()->getMinZ() + 2.5f;
     float maxZ = getWorld()->getLandscape()->getTerrain()->getMaxZ() - 2.5f;
 
-    if (m_position.x < minX) m_position.x = minX;
-    if (m_position.x > maxX) m_position.x = maxX;
-    if (m_position.z < minZ) m_position.z = minZ;
-    if (m_position.z > maxZ) m_position.z = maxZ;
+    if (position.x < minX) position.x = minX;
+    if (position.x > maxX) position.x = maxX;
+    if (position.z < minZ) position.z = minZ;
+    if (position.z > maxZ) position.z = maxZ;
+
+    setPosition(position);
 }
 
 void Player::onRender() const
@@ -91,38 +91,39 @@ void Player::onShutdown()
 
 void Player::yaw(const float val)
 {
-    m_yaw += val;
+    float newYaw = getYaw() + val;
+
+    if (newYaw >= 360.0f) newYaw -= 360.0f;
+    if (newYaw < 0.0f) newYaw += 360.0f;
 
-    if (m_yaw >= 360.0f) m_yaw -= 360.0f;
-    if (m_yaw < 0.0f) m_yaw += 360.0f;
-    
-    std::cout << "Yaw: " << m_yaw << std::endl;
+    setYaw(newYaw);
 }
 
 void Player::pitch(const float val)
 {
-    m_pitch += val;
+    float newPitch = getPitch() + val;
 
     const float PITCH_LIMIT = 45.0f;
 
-    if (m_pitch >= PITCH_LIMIT)
+    if (newPitch >= PITCH_LIMIT)
     {
-        m_pitch = PITCH_LIMIT;
+        newPitch = PITCH_LIMIT;
     }
 
-    if (m_pitch <= -PITCH_LIMIT)
+    if (newPitch <= -PITCH_LIMIT)
     {
-        m_pitch = -PITCH_LIMIT;
+        newPitch = -PITCH_LIMIT;
     }
-    std::cout << "Pitch: " << m_pitch << std::endl;
+
+    setPitch(newPitch);
 }
 
 void Player::moveForward(const float speed)
 {
     Vector3 pos = getPosition();
 
-    float cosYaw = cosf(degreesToRadians(m_yaw));
-    float sinYaw = sinf(degreesToRadians(m_yaw));
+    float cosYaw = cosf(degreesToRadians(getYaw()));
+    float sinYaw = sinf(degreesToRadians(getYaw()));
     pos.x += float(cosYaw)*speed;
     pos.z += float(sinYaw)*speed;
 
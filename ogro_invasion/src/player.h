@@ -24,21 +24,14 @@ class Player : public Entity
 
         virtual EntityType getType() const { return PLAYER; }
 
+        //The player fires rockets and the ogros watch where it is
+        virtual bool canPrepareInParallel() const { return false; }
+
         //At the moment the player doesn't collide with other entities
         virtual Collider* getCollider() { return m_collider; }
 
-        Vector3 getPosition() const { return m_position; }
-        void setPosition(const Vector3& pos) {
-            m_position = pos;
-        }
-
         Vector3 getVelocity() const { return m_velocity; }
 
-        float getYaw() const { return m_yaw; }
-        float getPitch() const { return m_pitch; }
-        void setYaw(const float yaw) { m_yaw = yaw; }
-        void setPitch(const float pitch) { m_pitch = pitch; }
-
         void yaw(const float val);
         void pitch(const float val);
         void moveForward(const float speed);
@@ -53,11 +46,8 @@ class Player : public Entity
         virtual bool onInitialize();
         virtual void onShutdown();
         virtual void onCollision(Entity* collider) { } //Players don't collide.. yet
-        Vector3 m_position;
         Vector3 m_velocity;
 
-        float m_yaw;
-        float m_pitch;
         Collider* m_collider;
 };
 
@@ -0,0 +1,110 @@
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+#include "profiler.h"
+
+using std::vector;
+
+static thread_local void* t_threadBuffer = NULL;
+
+Profiler& Profiler::get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler():
+m_enabled(true),
+m_startTime(Timer::now())
+{
+}
+
+Profiler::~Profiler()
+{
+    for (vector<ThreadBuffer*>::iterator buffer = m_buffers.begin(); buffer != m_buffers.end(); ++buffer)
+    {
+        delete (*buffer);
+    }
+}
+
+Profiler::ThreadBuffer* Profiler::getThreadBuffer()
+{
+    if (t_threadBuffer)
+    {
+        return static_cast<ThreadBuffer*>(t_threadBuffer);
+    }
+
+    //First zone on this thread, give it a buffer. This is the only time we lock.
+    ThreadBuffer* buffer = new ThreadBuffer();
+    buffer->events.resize(EVENTS_PER_THREAD);
+    buffer->written = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_buffersMutex);
+        buffer->threadID = m_buffers.size();
+        m_buffers.push_back(buffer);
+    }
+
+    t_threadBuffer = buffer;
+    return buffer;
+}
+
+void Profiler::record(const char* name, double start, double end)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+
+    unsigned int index = buffer->written.load(std::memory_order_relaxed);
+    Event& event = buffer->events[index % EVENTS_PER_THREAD];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+
+    //Publish the event to writeChromeTrace
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+bool Profiler::writeChromeTrace(const std::string& filename)
+{
+    std::ofstream fileOut(filename.c_str());
+    if (!fileOut.good())
+    {
+        std::cerr << "Could not open " << filename << " for writing" << std::endl;
+        return false;
+    }
+
+    const double MICROSECONDS = 1000000.0;
+
+    fileOut << std::fixed << std::setprecision(3);
+    fileOut << "{\"traceEvents\":[" << std::endl;
+
+    std::lock_guard<std::mutex> lock(m_buffersMutex);
+
+    bool first = true;
+    for (vector<ThreadBuffer*>::const_iterator it = m_buffers.begin(); it != m_buffers.end(); ++it)
+    {
+        const ThreadBuffer* buffer = (*it);
+
+        //Thread 0 is whoever recorded first, which is the main thread
+        fileOut << (first ? "" : ",\n")
+                << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->threadID
+                << ",\"args\":{\"name\":\"" << ((buffer->threadID == 0) ? "Main" : "Worker") << " " << buffer->threadID << "\"}}";
+        first = false;
+
+        unsigned int written = buffer->written.load(std::memory_order_acquire);
+        unsigned int oldest = (written > EVENTS_PER_THREAD) ? written - EVENTS_PER_THREAD : 0;
+
+        for (unsigned int i = oldest; i < written; ++i)
+        {
+            const Event& event = buffer->events[i % EVENTS_PER_THREAD];
+            fileOut << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->threadID
+                    << ",\"ts\":" << (event.start - m_startTime) * MICROSECONDS
+                    << ",\"dur\":" << (event.end - event.start) * MICROSECONDS << "}";
+        }
+    }
+
+    fileOut << std::endl << "]}" << std::endl;
+
+    std::cout << "Wrote the profile to " << filename << std::endl;
+    return true;
+}
@@ -0,0 +1,101 @@
+#ifndef PROFILER_H_INCLUDED
+#define PROFILER_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+#include "uncopyable.h"
+#include "timer.h"
+
+/**
+    Records how long named zones of code take. Each thread writes into
+    its own fixed size ring buffer (the oldest zones are overwritten) so
+    recording a zone never allocates or takes a lock.
+
+    writeChromeTrace() saves everything recorded so far in the Chrome
+    trace format, load it in chrome://tracing or ui.perfetto.dev. Zones
+    nest on the timeline so you can see what each one spent its time on.
+    It reads the other threads' buffers without stopping them, so call it
+    between frames when the workers are idle.
+
+    Use the PROFILE_ZONE macro rather than ProfileZone directly, it
+    compiles to nothing unless ENABLE_PROFILER is defined.
+*/
+class Profiler : private Uncopyable
+{
+public:
+    static Profiler& get();
+
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    bool isEnabled() const { return m_enabled; }
+
+    //name must be a string literal (or live as long as the profiler), it isn't copied
+    void record(const char* name, double start, double end);
+
+    bool writeChromeTrace(const std::string& filename);
+
+private:
+    Profiler();
+    ~Profiler();
+
+    static const unsigned int EVENTS_PER_THREAD = 1 << 16;
+
+    struct Event
+    {
+        const char* name;
+        double start;
+        double end;
+    };
+
+    struct ThreadBuffer
+    {
+        std::vector<Event> events;
+        std::atomic<unsigned int> written;
+        unsigned int threadID;
+    };
+
+    ThreadBuffer* getThreadBuffer();
+
+    std::vector<ThreadBuffer*> m_buffers;
+    std::mutex m_buffersMutex;
+
+    std::atomic<bool> m_enabled;
+    double m_startTime;
+};
+
+/**
+    Times the scope it lives in
+*/
+class ProfileZone : private Uncopyable
+{
+public:
+    explicit ProfileZone(const char* name):
+    m_name(name),
+    m_start(Profiler::get().isEnabled() ? Timer::now() : -1.0)
+    {
+    }
+
+    ~ProfileZone()
+    {
+        if (m_start >= 0.0)
+        {
+            Profiler::get().record(m_name, m_start, Timer::now());
+        }
+    }
+
+private:
+    const char* m_name;
+    double m_start;
+};
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_ZONE_JOIN2(a, b) a##b
+#define PROFILE_ZONE_JOIN(a, b) PROFILE_ZONE_JOIN2(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_JOIN(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#endif
+
+#endif // PROFILER_H_INCLUDED
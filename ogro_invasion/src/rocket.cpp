@@ -14,22 +14,28 @@
 #include "spherecollider.h"
 #include "md2model.h"
 #include "glslshader.h"
+#include "assetmanager.h"
+#include "landscape.h"
 
 using std::string;
 
 const string ROCKET_MODEL = "data/models/Rocket/rocket.md2";
 const string ROCKET_TEXTURE = "data/models/Rocket/rocket.tga";
 
+//The size of the hole a rocket leaves when it hits the ground
+const float CRATER_RADIUS = 2.0f;
+const float CRATER_DEPTH = 0.3f;
+
 Rocket::Rocket(GameWorld* world):
 Entity(world),
 m_collider(NULL),
-m_model(NULL)
+m_model(NULL),
+m_rocketTexID(0)
 {
     m_collider = new SphereCollider(this, 0.0f);
+    m_collider->setContinuous(true); //Fast enough to pass through things between steps
 
-    string vertexShader = (GLSLProgram::glsl130Supported())? "data/shaders/glsl1.30/model.vert" : "data/shaders/glsl1.20/model.vert";
-    string fragmentShader = (GLSLProgram::glsl130Supported())? "data/shaders/glsl1.30/model.frag" : "data/shaders/glsl1.20/model.frag";
-    m_model = new MD2Model(vertexShader, fragmentShader);
+    m_model = new MD2Model();
     m_model->setAnimation(Animation::IDLE);
 }
 
@@ -37,6 +43,11 @@ Rocket::~Rocket()
 {
     delete m_collider;
     delete m_model;
+
+    if (m_rocketTexID)
+    {
+        getWorld()->getAssets()->releaseTexture(m_rocketTexID);
+    }
 }
 
 void Rocket::onPrepare(float dT)
@@ -45,10 +56,10 @@ void Rocket::onPrepare(float dT)
 
     Vector3 velocity;
 
-    float cosYaw = cosf(degreesToRadians(m_yaw));
-    float sinYaw = sinf(degreesToRadians(m_yaw));
-    float sinPitch = sinf(degreesToRadians(m_pitch));
-    float cosPitch = cosf(degreesToRadians(m_pitch));
+    float cosYaw = cosf(degreesToRadians(getYaw()));
+    float sinYaw = sinf(degreesToRadians(getYaw()));
+    float sinPitch = sinf(degreesToRadians(getPitch()));
+    float cosPitch = cosf(degreesToRadians(getPitch()));
 
     const float speed = 20.0f;
 
@@ -58,8 +69,10 @@ void Rocket::onPrepare(float dT)
 
     const Vector3 gravity(0.0f, -1.0f, 0.0f);
 
-    m_position += velocity * dT;
-   // m_position += gravity * dT;
+    //A rocket moves far enough in a frame to pass clean through a ridge or
+    //an ogro, the colliders sweep it along the whole move to catch that
+    setPosition(getPosition() + velocity * dT);
+   // setPosition(getPosition() + gravity * dT);
 }
 
 void Rocket::onRender() const
@@ -68,13 +81,14 @@ void Rocket::onRender() const
     float dArray[16] = {0.0};
     glm::mat4 modelMatrix = glm::make_mat4(ptr);
     glPushMatrix();
-    Vector3 pos = getPosition();
+    Vector3 pos = getRenderPosition();
+    float yaw = getRenderYaw();
     glTranslatef(pos.x, pos.y, pos.z);
     modelMatrix = glm::translate(modelMatrix, glm::vec3(pos.x,pos.y,pos.z));
-    modelMatrix = glm::rotate(modelMatrix,getYaw(),glm::vec3(0.0f,-1.0f,0.0f));
-    modelMatrix = glm::rotate(modelMatrix,getPitch(),glm::vec3(0.0f,0.0f,1.0f));
+    modelMatrix = glm::rotate(modelMatrix,yaw,glm::vec3(0.0f,-1.0f,0.0f));
+    modelMatrix = glm::rotate(modelMatrix,getRenderPitch(),glm::vec3(0.0f,0.0f,1.0f));
     
-    glRotatef(getYaw(), 0.0f, -1.0f, 0.0f);
+    glRotatef(yaw, 0.0f, -1.0f, 0.0f);
     glBindTexture(GL_TEXTURE_2D, m_rocketTexID);
     modelMatrix = glm::scale(modelMatrix, glm::vec3(0.5f, 0.5f, 0.5f));
     const float *pSource = (const float*)glm::value_ptr(modelMatrix);
@@ -107,22 +121,20 @@ void Rocket::onPostRender()
 
 bool Rocket::onInitialize()
 {
-    bool result = m_model->load(ROCKET_MODEL);
-    if (result)
+    //A headless world has no context to ask, its models are loaded without shaders
+    string vertexShader, fragmentShader;
+    if (!getWorld()->isHeadless())
     {
-        if (!m_rocketTexture.load(ROCKET_TEXTURE))
-        {
-            result = false;
-        }
-        else
-        {
-            glGenTextures(1, &m_rocketTexID);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, m_rocketTexID);
-            gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGB8, m_rocketTexture.getWidth(),
-                              m_rocketTexture.getHeight(), GL_RGB, GL_UNSIGNED_BYTE,
-                              m_rocketTexture.getImageData());
-        }
+        vertexShader = (GLSLProgram::glsl130Supported())? "data/shaders/glsl1.30/model.vert" : "data/shaders/glsl1.20/model.vert";
+        fragmentShader = (GLSLProgram::glsl130Supported())? "data/shaders/glsl1.30/model.frag" : "data/shaders/glsl1.20/model.frag";
+    }
+
+    AssetManager* assets = getWorld()->getAssets();
+    bool result = m_model->load(assets, ROCKET_MODEL, vertexShader, fragmentShader);
+    if (result && !getWorld()->isHeadless())
+    {
+        m_rocketTexID = assets->acquireTexture(ROCKET_TEXTURE);
+        result = (m_rocketTexID != 0);
     }
 
     return result;
@@ -137,6 +149,15 @@ void Rocket::onCollision(Entity* collider)
 {
     if (collider->getType() == PLAYER) return;
 
+    //Go back to where it hit rather than where the step would have taken it
+    Vector3 previous = getPreviousPosition();
+    setPosition(previous + (getPosition() - previous) * getCollider()->getTimeOfImpact());
+
+    if (collider->getType() == LANDSCAPE)
+    {
+        static_cast<Landscape*>(collider)->getTerrain()->addCrater(getPosition(), CRATER_RADIUS, CRATER_DEPTH);
+    }
+
     //Create an explosion where the rocket is
     Entity* explosion = getWorld()->spawnEntity(EXPLOSION);
     explosion->setPosition(getPosition());
@@ -2,7 +2,6 @@
 #define ROCKET_H_INCLUDED
 
 #include "entity.h"
-#include "targa.h"
 
 class MD2Model;
 
@@ -11,14 +10,6 @@ public:
     Rocket(GameWorld* const);
     virtual ~Rocket();
 
-    Vector3 getPosition() const { return m_position; }
-    void setPosition(const Vector3& pos) { m_position = pos; }
-
-    float getYaw() const { return m_yaw; }
-    float getPitch() const { return m_pitch; }
-    void setYaw(const float yaw) { m_yaw = yaw; }
-    void setPitch(const float pitch) { m_pitch = pitch; }
-
     Collider* getCollider() { return m_collider; }
 
     EntityType getType() const { return ROCKET; }
@@ -30,16 +21,10 @@ private:
     virtual void onShutdown();
     virtual void onCollision(Entity* collider);
 
-    Vector3 m_position;
-
-    float m_yaw;
-    float m_pitch;
-
     Collider* m_collider;
 
     MD2Model* m_model;
-    unsigned int m_rocketTexID;
-    TargaImage m_rocketTexture;
+    unsigned int m_rocketTexID; //Shared between all the rockets
 };
 
 #endif // ROCKET_H_INCLUDED
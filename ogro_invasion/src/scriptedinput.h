@@ -0,0 +1,110 @@
+#ifndef SCRIPTEDINPUT_H_INCLUDED
+#define SCRIPTEDINPUT_H_INCLUDED
+
+#include <cstring>
+#include <cassert>
+
+#include "uncopyable.h"
+#include "keyboardinterface.h"
+#include "mouseinterface.h"
+
+/**
+    A keyboard and mouse that only do what they are told through the
+    handle/toggle/setMousePos methods, used to feed an InputScript into
+    the game. They behave exactly like the real ones: a key is "pressed"
+    on the update it goes down and "held" on the updates after that.
+*/
+class ScriptedKeyboardInterface : public KeyboardInterface {
+public:
+    ScriptedKeyboardInterface()
+    {
+        for (int i = 0; i < KC_MAX_KEYS; ++i) {
+            m_keyState[i] = 0;
+            m_lastKeyState[i] = 0;
+        }
+    }
+
+    virtual bool isKeyPressed(BOGLGPKeyCode code)
+    {
+        return (m_lastKeyState[code] == 0 && m_keyState[code] == 1);
+    }
+
+    virtual bool isKeyHeldDown(BOGLGPKeyCode code)
+    {
+        return (m_lastKeyState[code] && m_keyState[code]);
+    }
+
+    virtual void handleKeyDown(BOGLGPKeyCode code)
+    {
+        m_keyState[code] = 1;
+    }
+
+    virtual void handleKeyUp(BOGLGPKeyCode code)
+    {
+        m_keyState[code] = 0;
+    }
+
+    virtual BOGLGPKeyCode translateKey(unsigned int code)
+    {
+        return KC_INVALID; //There are no OS keys to translate
+    }
+
+    virtual void update()
+    {
+        memcpy(m_lastKeyState, m_keyState, sizeof(short) * KC_MAX_KEYS);
+    }
+
+private:
+    short m_keyState[KC_MAX_KEYS];
+    short m_lastKeyState[KC_MAX_KEYS];
+};
+
+class ScriptedMouseInterface : public MouseInterface
+{
+public:
+    ScriptedMouseInterface():
+    m_x(0),
+    m_y(0)
+    {
+        m_buttonState[0] = m_buttonState[1] = 0;
+        m_lastButtonState[0] = m_lastButtonState[1] = 0;
+    }
+
+    virtual void getMousePos(int& x, int& y)
+    {
+        x = m_x;
+        y = m_y;
+    }
+
+    virtual void setMousePos(int x, int y)
+    {
+        m_x = x;
+        m_y = y;
+    }
+
+    virtual void showCursor(bool val) { }
+
+    virtual bool isButtonPressed(int button)
+    {
+        assert(button < 2);
+        return (m_lastButtonState[button] == 0 && m_buttonState[button] == 1);
+    }
+
+    virtual void toggleMousebutton(int button, bool pressed)
+    {
+        assert(button < 2);
+        m_buttonState[button] = pressed ? 1 : 0;
+    }
+
+    virtual void update()
+    {
+        memcpy(m_lastButtonState, m_buttonState, sizeof(short) * 2);
+    }
+
+private:
+    int m_x, m_y;
+    short m_buttonState[2];
+    short m_lastButtonState[2];
+};
+
+#endif // SCRIPTEDINPUT_H_INCLUDED
@@ -3,10 +3,20 @@
 #include "spherecollider.h"
 
 SphereCollider::SphereCollider(Entity* entity, float radius):
-Collider(entity),
-m_radius(radius)
+Collider(entity)
 {
-    //ctor
+    entity->setRadius(radius);
+}
+
+//The radius is kept with the rest of the entity's state, so the broadphase can read it along with the position
+float SphereCollider::getRadius() const
+{
+    return getEntity()->getRadius();
+}
+
+void SphereCollider::setRadius(const float radius)
+{
+    getEntity()->setRadius(radius);
 }
 
 SphereCollider::~SphereCollider()
@@ -14,7 +24,50 @@ SphereCollider::~SphereCollider()
     //dtor
 }
 
-bool SphereCollider::collideWith(const Collider* collider)
+bool SphereCollider::sweep(const Vector3& startA, const Vector3& endA, float radiusA,
+                           const Vector3& startB, const Vector3& endB, float radiusB,
+                           float& timeOfImpact)
+{
+    /*
+        Working relative to B, A starts at offset and moves by motion. They
+        touch when |offset + motion * t| = radiusA + radiusB, which is a
+        quadratic in t, the smaller root being the first contact.
+    */
+    Vector3 offset = startA - startB;
+    Vector3 motion = (endA - startA) - (endB - startB);
+    float radius = radiusA + radiusB;
+
+    float c = (offset.x * offset.x + offset.y * offset.y + offset.z * offset.z) - radius * radius;
+    if (c <= 0.0f)
+    {
+        timeOfImpact = 0.0f; //Already touching
+        return true;
+    }
+
+    float a = motion.x * motion.x + motion.y * motion.y + motion.z * motion.z;
+    float b = 2.0f * (offset.x * motion.x + offset.y * motion.y + offset.z * motion.z);
+    if (a <= 0.0f || b >= 0.0f)
+    {
+        return false; //Not moving, or moving apart
+    }
+
+    float discriminant = b * b - 4.0f * a * c;
+    if (discriminant < 0.0f)
+    {
+        return false; //Passes by
+    }
+
+    float t = (-b - sqrtf(discriminant)) / (2.0f * a);
+    if (t > 1.0f)
+    {
+        return false; //Doesn't get there this step
+    }
+
+    timeOfImpact = t;
+    return true;
+}
+
+bool SphereCollider::collideWith(const Collider* collider, float& timeOfImpact)
 {
     Vector3 entityPosition = getEntity()->getPosition();
     float entityRadius = getRadius();
@@ -22,10 +75,29 @@ bool SphereCollider::collideWith(const Collider* collider)
     Vector3 otherPosition = collider->getEntity()->getPosition();
     float otherRadius = collider->getRadius();
 
+    if (isContinuous() || collider->isContinuous())
+    {
+        /*
+            A continuous sphere is swept from where it started the step, so
+            a rocket can't skip over something between two steps. The other
+            sphere is held where the collision pass last put it.
+        */
+        Vector3 entityStart = getEntity()->getPreviousPosition();
+        Vector3 otherStart = collider->getEntity()->getPreviousPosition();
+        Vector3 entityEnd = isContinuous() ? entityPosition : entityStart;
+        Vector3 otherEnd = collider->isContinuous() ? otherPosition : otherStart;
+
+        if (sweep(entityStart, entityEnd, entityRadius, otherStart, otherEnd, otherRadius, timeOfImpact))
+        {
+            return true;
+        }
+    }
+
     //If the distance between the 2 center points is less than the 2 radii combined
     //then this is a collision
     if ((entityPosition - otherPosition).length() <= (entityRadius + otherRadius))
     {
+        timeOfImpact = 1.0f;
         return true;
     }
 
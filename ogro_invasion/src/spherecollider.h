@@ -2,6 +2,7 @@
 #define SPHERECOLLIDER_H
 
 #include "collider.h"
+#include "geom.h"
 
 class SphereCollider : public Collider
 {
@@ -12,13 +13,21 @@ class SphereCollider : public Collider
         /** Default destructor */
         virtual ~SphereCollider();
 
-        virtual float getRadius() const { return m_radius; }
-        void setRadius(const float radius) { m_radius = radius; }
+        virtual float getRadius() const;
+        void setRadius(const float radius);
 
-    private:
-        bool collideWith(const Collider* collider);
+        /**
+            Moves sphere A from startA to endA and sphere B from startB to
+            endB over the same time and finds when they first touch, as a
+            fraction of the way along (0 if they already overlap at the
+            start). Returns false if they never touch.
+        */
+        static bool sweep(const Vector3& startA, const Vector3& endA, float radiusA,
+                          const Vector3& startB, const Vector3& endB, float radiusB,
+                          float& timeOfImpact);
 
-        float m_radius;
+    private:
+        bool collideWith(const Collider* collider, float& timeOfImpact);
 };
 
 #endif // SPHERECOLLIDER_H
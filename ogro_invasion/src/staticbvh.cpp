@@ -0,0 +1,236 @@
+#include <algorithm>
+
+#include "staticbvh.h"
+#include "entitystore.h"
+#include "entity.h"
+#include "collider.h"
+#include "frustum.h"
+
+using std::vector;
+
+namespace
+{
+    //Orders props along one axis, for splitting a node at the middle prop
+    struct CompareAlongAxis
+    {
+        int axis;
+
+        CompareAlongAxis(int a):
+        axis(a)
+        {
+        }
+
+        bool operator()(const StaticBVH::Prop& lhs, const StaticBVH::Prop& rhs) const
+        {
+            if (axis == 0) return lhs.position.x < rhs.position.x;
+            if (axis == 1) return lhs.position.y < rhs.position.y;
+            return lhs.position.z < rhs.position.z;
+        }
+    };
+}
+
+StaticBVH::StaticBVH():
+m_layers(0)
+{
+}
+
+void StaticBVH::clear()
+{
+    m_nodes.clear();
+    m_props.clear();
+    m_layers = 0;
+}
+
+void StaticBVH::build(const EntityStore& entities)
+{
+    clear();
+
+    for (unsigned int i = 0; i < entities.getCount(); ++i)
+    {
+        if (!entities.isStatic(i) || entities.canBeRemoved(i))
+        {
+            continue;
+        }
+
+        Prop prop;
+        prop.entity = entities.getEntity(i);
+        prop.collider = entities.getCollider(i);
+        prop.position = entities.getPosition(i);
+        prop.radius = entities.getRadius(i);
+        m_props.push_back(prop);
+
+        if (prop.collider)
+        {
+            m_layers |= prop.collider->getLayer();
+        }
+    }
+
+    if (!m_props.empty())
+    {
+        //A binary tree with at least one prop per leaf has fewer than twice as many nodes as props
+        m_nodes.reserve(m_props.size() * 2);
+        buildNode(0, m_props.size());
+    }
+}
+
+/**
+    Splits the props at the middle one along the longest side of the box
+    around their centres. Splitting at the middle keeps the tree balanced
+    (so never deeper than MAX_DEPTH) however the props are spread out.
+*/
+unsigned int StaticBVH::buildNode(unsigned int first, unsigned int count)
+{
+    const unsigned int index = m_nodes.size();
+    m_nodes.push_back(Node());
+
+    Vector3 min = m_props[first].position;
+    Vector3 max = min;
+    Vector3 centreMin = min;
+    Vector3 centreMax = max;
+    for (unsigned int i = first; i < first + count; ++i)
+    {
+        const Prop& prop = m_props[i];
+        min.x = std::min(min.x, prop.position.x - prop.radius);
+        min.y = std::min(min.y, prop.position.y - prop.radius);
+        min.z = std::min(min.z, prop.position.z - prop.radius);
+        max.x = std::max(max.x, prop.position.x + prop.radius);
+        max.y = std::max(max.y, prop.position.y + prop.radius);
+        max.z = std::max(max.z, prop.position.z + prop.radius);
+
+        centreMin.x = std::min(centreMin.x, prop.position.x);
+        centreMin.y = std::min(centreMin.y, prop.position.y);
+        centreMin.z = std::min(centreMin.z, prop.position.z);
+        centreMax.x = std::max(centreMax.x, prop.position.x);
+        centreMax.y = std::max(centreMax.y, prop.position.y);
+        centreMax.z = std::max(centreMax.z, prop.position.z);
+    }
+
+    unsigned int right = 0;
+    if (count > MAX_LEAF_PROPS)
+    {
+        const float width = centreMax.x - centreMin.x;
+        const float height = centreMax.y - centreMin.y;
+        const float depth = centreMax.z - centreMin.z;
+
+        int axis = 0;
+        if (height > width && height >= depth) axis = 1;
+        else if (depth > width && depth > height) axis = 2;
+
+        const unsigned int half = count / 2;
+        std::nth_element(m_props.begin() + first, m_props.begin() + first + half,
+                         m_props.begin() + first + count, CompareAlongAxis(axis));
+
+        buildNode(first, half);
+        right = buildNode(first + half, count - half);
+    }
+
+    //Filled in last, the vector may have moved while the children were added
+    Node& node = m_nodes[index];
+    node.min = min;
+    node.max = max;
+    node.first = first;
+    node.count = count;
+    node.right = right;
+
+    return index;
+}
+
+const vector<unsigned int>& StaticBVH::findProps(const Vector3& centre, float radius) const
+{
+    m_foundProps.clear();
+    if (m_nodes.empty())
+    {
+        return m_foundProps;
+    }
+
+    unsigned int stack[MAX_DEPTH];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const unsigned int index = stack[--stackSize];
+        const Node& node = m_nodes[index];
+
+        //Skip the node if the sphere is further from its box than its radius
+        const float dx = std::max(std::max(node.min.x - centre.x, centre.x - node.max.x), 0.0f);
+        const float dy = std::max(std::max(node.min.y - centre.y, centre.y - node.max.y), 0.0f);
+        const float dz = std::max(std::max(node.min.z - centre.z, centre.z - node.max.z), 0.0f);
+        if (dx * dx + dy * dy + dz * dz > radius * radius)
+        {
+            continue;
+        }
+
+        if (node.right == 0)
+        {
+            for (unsigned int i = node.first; i < node.first + node.count; ++i)
+            {
+                const Prop& prop = m_props[i];
+                const Vector3 offset = prop.position - centre;
+                const float reach = prop.radius + radius;
+                if (offset.x * offset.x + offset.y * offset.y + offset.z * offset.z <= reach * reach)
+                {
+                    m_foundProps.push_back(i);
+                }
+            }
+            continue;
+        }
+
+        //The first child is pushed last so it's visited first
+        stack[stackSize++] = node.right;
+        stack[stackSize++] = index + 1;
+    }
+
+    return m_foundProps;
+}
+
+void StaticBVH::findVisible(Frustum& frustum, vector<Entity*>& visible) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    unsigned int stack[MAX_DEPTH];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const unsigned int index = stack[--stackSize];
+        const Node& node = m_nodes[index];
+
+        Frustum::BoxResult result = frustum.boxInFrustum(node.min.x, node.min.y, node.min.z,
+                                                         node.max.x, node.max.y, node.max.z);
+        if (result == Frustum::BOX_OUTSIDE)
+        {
+            continue;
+        }
+
+        if (result == Frustum::BOX_INSIDE)
+        {
+            //Everything under here can be seen
+            for (unsigned int i = node.first; i < node.first + node.count; ++i)
+            {
+                visible.push_back(m_props[i].entity);
+            }
+            continue;
+        }
+
+        if (node.right == 0)
+        {
+            for (unsigned int i = node.first; i < node.first + node.count; ++i)
+            {
+                const Prop& prop = m_props[i];
+                if (frustum.sphereInFrustum(prop.position.x, prop.position.y, prop.position.z, prop.radius))
+                {
+                    visible.push_back(prop.entity);
+                }
+            }
+            continue;
+        }
+
+        stack[stackSize++] = node.right;
+        stack[stackSize++] = index + 1;
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef STATICBVH_H_INCLUDED
+#define STATICBVH_H_INCLUDED
+
+#include <vector>
+
+#include "geom.h"
+#include "uncopyable.h"
+
+class Entity;
+class Collider;
+class EntityStore;
+class Frustum;
+
+/**
+    A bounding volume hierarchy over the static entities in the world
+    (the trees), the ones that never move once they've been placed.
+    It's built once when they are spawned, after that they are left out
+    of the collision grid and the render loop. The moving colliders that
+    can hit them ask the hierarchy for the few that are near them, and
+    rendering culls whole branches against the frustum at a time.
+
+    Each node is a box around the bounding spheres of its props. The
+    props under a node are kept together in one run of the array, so a
+    node that's wholly in view hands its props over without testing any
+    of them.
+*/
+class StaticBVH : private Uncopyable
+{
+public:
+    struct Prop
+    {
+        Entity* entity;
+        Collider* collider;
+        Vector3 position;
+        float radius;
+    };
+
+    StaticBVH();
+
+    //Builds the hierarchy from the static entities in the store, throwing away the old one
+    void build(const EntityStore& entities);
+    void clear();
+
+    bool isEmpty() const { return m_props.empty(); }
+
+    //Every collider layer used by a prop, anything that can't hit one of these doesn't need to ask
+    unsigned int getLayers() const { return m_layers; }
+
+    const Prop& getProp(unsigned int i) const { return m_props[i]; }
+
+    /**
+        The index of every prop whose bounding sphere touches the sphere.
+        The returned vector is reused so it is only valid until the next
+        call.
+    */
+    const std::vector<unsigned int>& findProps(const Vector3& centre, float radius) const;
+
+    //Adds every prop that could be seen
+    void findVisible(Frustum& frustum, std::vector<Entity*>& visible) const;
+
+private:
+    static const unsigned int MAX_LEAF_PROPS = 4;
+    static const unsigned int MAX_DEPTH = 64;
+
+    struct Node
+    {
+        Vector3 min;
+        Vector3 max;
+        unsigned int first; //The node's props are m_props[first] to m_props[first + count - 1]
+        unsigned int count;
+        unsigned int right; //The second child, the first is always the next node. 0 for a leaf.
+    };
+
+    unsigned int buildNode(unsigned int first, unsigned int count);
+
+    std::vector<Node> m_nodes; //The root is the first node
+    std::vector<Prop> m_props;
+    unsigned int m_layers;
+
+    mutable std::vector<unsigned int> m_foundProps; //Reused by every findProps() to save allocating
+};
+
+#endif // STATICBVH_H_INCLUDED
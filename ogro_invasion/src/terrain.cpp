@@ -7,6 +7,13 @@
 #include <iostream>
 #include <cassert>
 #include <vector>
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TERRAIN_USE_SSE2
+#endif
 
 
 #include "terrain.h"
@@ -18,57 +25,106 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "glslshader.h"
+#include "frustum.h"
+#include "tiledheightmap.h"
+#include "mappedfile.h"
+#include "terraincache.h"
+#include "heightquadtree.h"
+#include "jobsystem.h"
+#include "profiler.h"
 
 using std::vector;
 using std::string;
 
+//Chunks closer than this are drawn at full detail, the detail halves each time the distance doubles
+const float LOD_DISTANCE = 24.0f;
+
+//Chunks within this distance are kept on the GPU, it reaches a little past the far plane
+const float STREAMING_DISTANCE = 64.0f;
+const unsigned int MAX_RESIDENT_CHUNKS = 256;
+
+//Spread the uploads over a few frames rather than stalling when lots come into range at once
+const int MAX_CHUNK_UPLOADS_PER_FRAME = 4;
+
+//Ends one triangle strip and starts the next
+const GLushort RESTART_INDEX = 0xFFFF;
+
+/*
+    The strips are laid out in bands this many quads wide, so the vertices
+    a row shares with the one before are still in the GPU's vertex cache
+*/
+const int STRIP_BAND_WIDTH = 8;
+
+//The grass texture repeats this many times across the terrain
+const float TEXCOORD_SCALE = 8.0f;
+
+//Used instead of the terrain's own shaders when it's displaced on the GPU
+const string DISPLACED_VERTEX_SHADER = "data/shaders/glsl1.30/terrain_displaced.vert";
+const string DISPLACED_FRAGMENT_SHADER = "data/shaders/glsl1.30/terrain.frag";
+
+//Vertices start morphing into the next level of detail this far towards the distance their chunk switches to it
+const float LOD_MORPH_START = 0.75f;
+
 Terrain::Terrain(const string& vertexShader, const string& fragmentShader, const string& waterVert, const string& waterFrag):
-m_vertexBuffer(0),
-m_indexBuffer(0),
-m_colorBuffer(0),
+m_heightScale(1.0f),
+m_jobs(NULL),
+m_usePrimitiveRestart(false),
+m_levelCount(0),
+m_skirtDepth(0.0f),
+m_heightQuantMin(0.0f),
+m_heightQuantMax(0.0f),
+m_heightQuantStep(1.0f),
+m_normalScale(1.0f),
+m_heightTexScale(1.0f),
+m_heightTexOffset(0.0f),
+m_displacementEnabled(false),
+m_isDisplaced(false),
+m_heightFieldTexID(0),
+m_patchVertexBuffer(0),
 m_width(0),
 m_isMultitextureEnabled(true),
 m_shaderProgram(NULL),
-m_waterShaderProgram(NULL)
+m_waterShaderProgram(NULL),
+m_vertexShader(vertexShader),
+m_fragmentShader(fragmentShader),
+m_waterVertexShader(waterVert),
+m_waterFragmentShader(waterFrag)
 {
-    m_shaderProgram = new GLSLProgram(vertexShader, fragmentShader);
-    if (!waterFrag.empty() && !waterVert.empty())
-    {
-        m_waterShaderProgram = new GLSLProgram(waterVert, waterFrag);
-    }
+    //The shaders aren't created until initializeGraphics() so the
+    //terrain can be used without a GL context
 }
 
 Terrain::~Terrain()
 {
-    delete m_shaderProgram;
-    delete m_waterShaderProgram;
-}
-
-void Terrain::generateVertices(const vector<float> heights, int width)
-{
-    //Generate the vertices
-    int i = 0;
-    float halfWidth = float(width) * 0.5f;
-
-    for (int z = 0; z < width; ++z)
+    for (vector<Chunk>::iterator chunk = m_chunks.begin(); chunk != m_chunks.end(); ++chunk)
     {
-        for (int x = 0; x < width; ++x)
+        if ((*chunk).vertexBuffer)
         {
-            m_vertices.push_back(Vertex(float(x) - halfWidth, heights[i++], float(z) - halfWidth));
+            glDeleteBuffers(1, &(*chunk).vertexBuffer);
         }
     }
 
-    /*for (float z = -halfWidth; z < halfWidth; z += 1.0f)
+    if (!m_levelIndexBuffers.empty())
     {
-        for (float x = -halfWidth; x < halfWidth; x += 1.0f)
-        {
-            m_vertices.push_back(Vertex(x, heights[i++], z));
-        }
-    }*/
+        glDeleteBuffers(m_levelIndexBuffers.size(), &m_levelIndexBuffers[0]);
+    }
 
-    glGenBuffers(1, &m_vertexBuffer); //Generate a buffer for the vertices
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer); //Bind the vertex buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * m_vertices.size() * 3, &m_vertices[0], GL_STATIC_DRAW); //Send the data to OpenGL
+    if (m_isDisplaced)
+    {
+        glDeleteTextures(1, &m_heightFieldTexID);
+        glDeleteBuffers(1, &m_patchVertexBuffer);
+    }
+
+    delete m_shaderProgram;
+    delete m_waterShaderProgram;
+}
+
+void Terrain::storeHeights(const vector<float>& heights, int width)
+{
+    m_heights = heights;
+    m_width = width;
+
+    float halfWidth = float(width) * 0.5f;
 
     m_minX = -halfWidth;
     m_maxX = halfWidth;
@@ -95,42 +151,6 @@ void Terrain::generateWaterVertices(int width)
             m_waterVertices.push_back(Vertex(x, waterHeight, z));
         }
     }*/
-
-    glGenBuffers(1, &m_waterVertexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_waterVertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * m_waterVertices.size() * 3, &m_waterVertices[0], GL_STATIC_DRAW);
-}
-
-void Terrain::generateIndices(int width)
-{
-    /*
-        We loop through building the triangles that
-        make up each grid square in the heightmap
-
-        (z*w+x) *----* (z*w+x+1)
-                |   /|
-                |  / |
-                | /  |
-     ((z+1)*w+x)*----* ((z+1)*w+x+1)
-    */
-    //Generate the triangle indices
-    for (int z = 0; z < width - 1; ++z) //Go through the rows - 1
-    {
-        for (int x = 0; x < width - 1; ++x) //And the columns - 1
-        {
-            m_indices.push_back((z * width) + x); //Current point
-            m_indices.push_back(((z + 1) * width) + x); //Next row
-            m_indices.push_back((z * width) + x + 1); //Same row, but next column
-
-            m_indices.push_back(((z + 1) * width) + x); //Next row
-            m_indices.push_back(((z + 1) * width) + x + 1); //Next row, next column
-            m_indices.push_back((z * width) + x + 1); //Same row, but next column
-        }
-    }
-
-    glGenBuffers(1, &m_indexBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * m_indices.size(), &m_indices[0], GL_STATIC_DRAW);
 }
 
 void Terrain::generateWaterIndices(int width)
@@ -159,24 +179,6 @@ void Terrain::generateWaterIndices(int width)
             m_waterIndices.push_back((z * waterWidth) + x + 1); //Same row, but next column
         }
     }*/
-
-    glGenBuffers(1, &m_waterIndexBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_waterIndexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * m_waterIndices.size(), &m_waterIndices[0], GL_STATIC_DRAW);
-}
-
-Vertex* crossProduct(Vertex* out, Vertex* v1, Vertex* v2)
-{
-    Vertex v;
-    v.x = (v1->y * v2->z) - (v1->z * v2->y);
-	v.y = (v1->z * v2->x) - (v1->x * v2->z);
-	v.z = (v1->x * v2->y) - (v1->y * v2->x);
-
-    out->x = v.x;
-    out->y = v.y;
-    out->z = v.z;
-
-    return out;
 }
 
 Vertex* normalize(Vertex* in)
@@ -188,64 +190,803 @@ Vertex* normalize(Vertex* in)
     return in;
 }
 
+//Does the same sums as the SSE version in generateNormalRow() so they both give the same normals
+static void getCentralDifferenceNormal(float left, float right, float above, float below, float scale, Vertex& normal)
+{
+    normal.x = (left - right) * scale;
+    normal.y = 2.0f;
+    normal.z = (above - below) * scale;
+    normalize(&normal);
+}
+
 void Terrain::generateNormals()
 {
-    vector<Vertex> faceNormals; //Temporary array to store the face normals
-    vector<int> shareCount;
+    m_normals.resize(m_heights.size()); //We want a normal for each vertex
+    updateNormals(0, 0, m_width - 1, m_width - 1);
+}
+
+/**
+    Works out the normals of the grid positions given (inclusive) from
+    central differences: the slope across each vertex comes from its
+    neighbours on either side, so every normal only needs the heights
+    around it and the rows can be worked on at the same time.
+*/
+void Terrain::updateNormals(int minX, int minZ, int maxX, int maxZ)
+{
+    const unsigned int rows = maxZ - minZ + 1;
+
+    if (m_jobs && rows > NORMAL_ROWS_PER_JOB)
+    {
+        m_jobs->parallelFor(rows, NORMAL_ROWS_PER_JOB,
+            [this, minX, minZ, maxX](unsigned int begin, unsigned int end)
+            {
+                for (unsigned int row = begin; row < end; ++row)
+                {
+                    generateNormalRow(minZ + row, minX, maxX);
+                }
+            });
+        return;
+    }
+
+    for (int z = minZ; z <= maxZ; ++z)
+    {
+        generateNormalRow(z, minX, maxX);
+    }
+}
+
+/**
+    The normals along part of one row. Neighbours off the edge of the map
+    are clamped to it, the same as a tiled heightmap does.
+*/
+void Terrain::generateNormalRow(int z, int minX, int maxX)
+{
+    const float* above = &m_heights[std::max(z - 1, 0) * m_width];
+    const float* row = &m_heights[z * m_width];
+    const float* below = &m_heights[std::min(z + 1, m_width - 1) * m_width];
+    Vertex* normals = &m_normals[z * m_width];
+
+    int x = minX;
+    if (x == 0 && x <= maxX)
+    {
+        getCentralDifferenceNormal(row[0], row[1], above[0], below[0], m_normalScale, normals[0]);
+        ++x;
+    }
+
+#ifdef TERRAIN_USE_SSE2
+    const __m128 scale = _mm_set1_ps(m_normalScale);
+    const __m128 up = _mm_set1_ps(2.0f);
+    const __m128 upSquared = _mm_mul_ps(up, up);
+
+    //Four at a time while both neighbours are on the map
+    for (; x + 4 <= std::min(maxX + 1, m_width - 1); x += 4)
+    {
+        __m128 nx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(row + x - 1), _mm_loadu_ps(row + x + 1)), scale);
+        __m128 nz = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(above + x), _mm_loadu_ps(below + x)), scale);
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), upSquared), _mm_mul_ps(nz, nz)));
+
+        float xs[4], ys[4], zs[4];
+        _mm_storeu_ps(xs, _mm_div_ps(nx, length));
+        _mm_storeu_ps(ys, _mm_div_ps(up, length));
+        _mm_storeu_ps(zs, _mm_div_ps(nz, length));
+
+        for (int i = 0; i < 4; ++i)
+        {
+            normals[x + i] = Vertex(xs[i], ys[i], zs[i]);
+        }
+    }
+#endif
+
+    for (; x <= maxX; ++x)
+    {
+        getCentralDifferenceNormal(row[x - 1], row[std::min(x + 1, m_width - 1)], above[x], below[x],
+                                   m_normalScale, normals[x]);
+    }
+}
+
+/**
+    Works out the normals and height texture coordinates of the grid
+    positions given (inclusive) again, after their heights have changed.
+*/
+void Terrain::updateShading(int minX, int minZ, int maxX, int maxZ)
+{
+    updateNormals(minX, minZ, maxX, maxZ);
+
+    for (int z = minZ; z <= maxZ; ++z)
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            int i = (z * m_width) + x;
+            m_heightTexCoords[i] = (m_heights[i] * m_heightTexScale) + m_heightTexOffset;
+        }
+    }
+}
+
+/**
+    A baked terrain is drawn straight from the mapped file, which can't be
+    changed. Before it can be deformed the heights are copied out and the
+    shading worked out again (once, for the whole map), after that it's
+    the same as a terrain built by loadHeightmap().
+*/
+void Terrain::unbakeCache()
+{
+    const float* heights = m_cache->getHeights();
+    m_heights.assign(heights, heights + (m_width * m_width));
+    m_cache.reset();
+
+    if (m_isDisplaced)
+    {
+        return; //The shader works the shading out for itself
+    }
+
+    m_normals.resize(m_heights.size());
+    m_heightTexCoords.resize(m_heights.size());
+    updateShading(0, 0, m_width - 1, m_width - 1);
+}
+
+/**
+    Gives the grid position of vertex i along one of a chunk's edges,
+    edges are numbered top, bottom, left, right
+*/
+static void getEdgeVertex(int edge, int i, int size, int& x, int& z)
+{
+    switch (edge)
+    {
+        case 0: x = i; z = 0; break;
+        case 1: x = i; z = size; break;
+        case 2: x = 0; z = i; break;
+        default: x = size; z = i; break;
+    }
+}
+
+void Terrain::generateChunks()
+{
+    m_chunks.clear();
+
+    const int chunksPerSide = (m_width - 1) / CHUNK_SIZE;
+    for (int z = 0; z < chunksPerSide; ++z)
+    {
+        for (int x = 0; x < chunksPerSide; ++x)
+        {
+            Chunk chunk;
+            chunk.startX = x * CHUNK_SIZE;
+            chunk.startZ = z * CHUNK_SIZE;
+            chunk.vertexBuffer = 0;
+            m_chunks.push_back(chunk);
+        }
+    }
+
+    //Each level uses every other vertex of the one before, down to a single quad
+    m_levelCount = 0;
+    while ((CHUNK_SIZE >> m_levelCount) >= 1)
+    {
+        ++m_levelCount;
+    }
+
+    updateChunkBounds();
+}
+
+void Terrain::updateQuadtree()
+{
+    if (m_tiles.get())
+    {
+        //The tile table already has the bounds, so the leaves are whole tiles
+        //and no heights need paging in
+        m_quadtree.reset(new HeightQuadtree(*this, CHUNK_SIZE));
+        for (int tileZ = 0; tileZ < m_tiles->getTilesPerSide(); ++tileZ)
+        {
+            for (int tileX = 0; tileX < m_tiles->getTilesPerSide(); ++tileX)
+            {
+                m_quadtree->setLeafBounds(tileX, tileZ, m_tiles->getTileMinHeight(tileX, tileZ) * m_heightScale,
+                                          m_tiles->getTileMaxHeight(tileX, tileZ) * m_heightScale);
+            }
+        }
+        m_quadtree->updateParents();
+        return;
+    }
+
+    m_quadtree.reset(new HeightQuadtree(*this, QUADTREE_LEAF_SIZE));
+    m_quadtree->rebuild();
+}
+
+void Terrain::updateChunkBounds()
+{
+    const float halfWidth = float(m_width) * 0.5f;
+
+    updateQuadtree();
+
+    for (vector<Chunk>::iterator chunk = m_chunks.begin(); chunk != m_chunks.end(); ++chunk)
+    {
+        float lowest, highest;
+
+        if (m_tiles.get())
+        {
+            //Saves paging in the whole map just to find the bounds
+            int tileX = (*chunk).startX / CHUNK_SIZE;
+            int tileZ = (*chunk).startZ / CHUNK_SIZE;
+            lowest = m_tiles->getTileMinHeight(tileX, tileZ) * m_heightScale;
+            highest = m_tiles->getTileMaxHeight(tileX, tileZ) * m_heightScale;
+        }
+        else if (m_cache.get())
+        {
+            lowest = m_cache->getChunkMinHeight(chunk - m_chunks.begin());
+            highest = m_cache->getChunkMaxHeight(chunk - m_chunks.begin());
+        }
+        else
+        {
+            m_quadtree->getHeightRange((*chunk).startX, (*chunk).startZ, (*chunk).startX + CHUNK_SIZE,
+                                       (*chunk).startZ + CHUNK_SIZE, lowest, highest);
+        }
+
+        (*chunk).minBounds = Vertex(float((*chunk).startX) - halfWidth, lowest, float((*chunk).startZ) - halfWidth);
+        (*chunk).maxBounds = Vertex(float((*chunk).startX + CHUNK_SIZE) - halfWidth, highest,
+                                    float((*chunk).startZ + CHUNK_SIZE) - halfWidth);
+    }
+
+    float minHeight = m_chunks[0].minBounds.y;
+    float maxHeight = m_chunks[0].maxBounds.y;
+    for (vector<Chunk>::const_iterator chunk = m_chunks.begin(); chunk != m_chunks.end(); ++chunk)
+    {
+        if ((*chunk).minBounds.y < minHeight) minHeight = (*chunk).minBounds.y;
+        if ((*chunk).maxBounds.y > maxHeight) maxHeight = (*chunk).maxBounds.y;
+    }
+
+    //A skirt as deep as the whole terrain covers any gap between two levels
+    m_skirtDepth = maxHeight - minHeight;
+
+    //The quantized heights have to reach the bottom of the skirts
+    m_heightQuantMin = minHeight - m_skirtDepth;
+    m_heightQuantMax = maxHeight;
+    m_heightQuantStep = (maxHeight - m_heightQuantMin) / 65535.0f;
+    if (m_heightQuantStep <= 0.0f)
+    {
+        m_heightQuantStep = 1.0f; //Flat
+    }
+}
+
+float Terrain::getGridHeight(int x, int z) const
+{
+    if (m_tiles.get())
+    {
+        return m_tiles->getHeight(x, z) * m_heightScale;
+    }
+
+    return getHeightData()[(z * m_width) + x];
+}
+
+/**
+    The heights as one dense row by row array, whether they were built
+    or mapped from a baked cache. A tiled heightmap has no such array so
+    this returns NULL.
+*/
+const float* Terrain::getHeightData() const
+{
+    if (m_cache.get())
+    {
+        return m_cache->getHeights();
+    }
+
+    return (m_heights.empty()) ? NULL : &m_heights[0];
+}
+
+static unsigned short toUnsignedNormalized(float value)
+{
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    return (unsigned short)((value * 65535.0f) + 0.5f);
+}
+
+static short toSignedNormalized(float value)
+{
+    value = std::min(std::max(value, -1.0f), 1.0f);
+    return (short)floorf((value * 32767.0f) + 0.5f);
+}
+
+/**
+    Octahedral encoding: the normal is projected onto an octahedron and
+    the lower half folded over the upper, so x and z are enough to get it
+    back. The shaders' decodeNormal() reverses this.
+*/
+static void encodeNormal(const Vertex& normal, short& x, short& z)
+{
+    float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    float ox = normal.x / length;
+    float oz = normal.z / length;
+
+    if (normal.y < 0.0f)
+    {
+        float foldedX = (1.0f - fabsf(oz)) * ((ox >= 0.0f) ? 1.0f : -1.0f);
+        float foldedZ = (1.0f - fabsf(ox)) * ((oz >= 0.0f) ? 1.0f : -1.0f);
+        ox = foldedX;
+        oz = foldedZ;
+    }
+
+    x = toSignedNormalized(ox);
+    z = toSignedNormalized(oz);
+}
+
+/**
+    Everything the chunks need for the vertex at grid position x, z,
+    apart from its position within the chunk which the caller fills in.
+    drop lowers the vertex, for the skirts. A tiled heightmap only stores
+    heights so the rest is worked out here.
+*/
+void Terrain::getGridVertex(int x, int z, float drop, TerrainVertex& vertex) const
+{
+    float y = getGridHeight(x, z) - drop;
+    vertex.y = (unsigned short)std::min(std::max(floorf(((y - m_heightQuantMin) / m_heightQuantStep) + 0.5f), 0.0f), 65535.0f);
+
+    vertex.s = toUnsignedNormalized(float(x) / float(m_width));
+    vertex.t = toUnsignedNormalized(float(z) / float(m_width));
+
+    Vertex normal;
+    float heightTexCoord;
+
+    if (!m_tiles.get())
+    {
+        int i = (z * m_width) + x;
+        normal = m_normals[i];
+        heightTexCoord = m_heightTexCoords[i];
+    }
+    else
+    {
+        //Same as generateTexCoords(), from the heights before they were scaled
+        float height = m_tiles->getHeight(x, z);
+        float minHeight = m_tiles->getMinHeight();
+        float maxHeight = m_tiles->getMaxHeight();
+        heightTexCoord = (minHeight + height) / (maxHeight - minHeight);
+
+        //Also from the unscaled heights like generateNormals()
+        getCentralDifferenceNormal(m_tiles->getHeight(x - 1, z), m_tiles->getHeight(x + 1, z),
+                                   m_tiles->getHeight(x, z - 1), m_tiles->getHeight(x, z + 1), 1.0f, normal);
+    }
+
+    //The height texture is clamped, so clamping the coordinate doesn't change anything
+    vertex.height = toUnsignedNormalized(heightTexCoord);
+    encodeNormal(normal, vertex.normalX, vertex.normalZ);
+}
+
+//x and z are relative to the chunk's first vertex
+void Terrain::buildChunkVertex(const Chunk& chunk, int x, int z, float drop, TerrainVertex& vertex) const
+{
+    getGridVertex(chunk.startX + x, chunk.startZ + z, drop, vertex);
+    vertex.x = (unsigned short)x;
+    vertex.z = (unsigned short)z;
+}
+
+/**
+    Builds the chunk's part of the terrain, plus its skirts. The grid comes
+    first, row by row, then the four skirts.
+*/
+void Terrain::buildChunkVertices(const Chunk& chunk, vector<TerrainVertex>& vertices) const
+{
+    const int side = CHUNK_SIZE + 1;
+    vertices.resize((side * side) + (4 * side));
+
+    int i = 0;
+    for (int z = 0; z < side; ++z)
+    {
+        for (int x = 0; x < side; ++x, ++i)
+        {
+            buildChunkVertex(chunk, x, z, 0.0f, vertices[i]);
+        }
+    }
+
+    //The skirts are copies of the edge vertices pushed straight down
+    for (int edge = 0; edge < 4; ++edge)
+    {
+        for (int j = 0; j < side; ++j, ++i)
+        {
+            int x, z;
+            getEdgeVertex(edge, j, CHUNK_SIZE, x, z);
+            buildChunkVertex(chunk, x, z, m_skirtDepth, vertices[i]);
+        }
+    }
+}
+
+void Terrain::uploadChunk(Chunk& chunk) const
+{
+    if (!chunk.vertexBuffer)
+    {
+        glGenBuffers(1, &chunk.vertexBuffer);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vertexBuffer);
+
+    if (m_cache.get())
+    {
+        //Straight from the mapped file, nothing to build
+        int index = &chunk - &m_chunks[0];
+        glBufferData(GL_ARRAY_BUFFER, sizeof(TerrainVertex) * m_cache->getChunkVertexCount(),
+                     m_cache->getChunkVertices(index), GL_STATIC_DRAW);
+        return;
+    }
+
+    vector<TerrainVertex> vertices;
+    buildChunkVertices(chunk, vertices);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(TerrainVertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+}
+
+/**
+    Sends the vertices of the grid positions given (inclusive) again,
+    along with the parts of the skirts hanging from them. Whole rows are
+    sent so the grid is one range of the buffer.
+*/
+void Terrain::uploadChunkRegion(const Chunk& chunk, int minX, int minZ, int maxX, int maxZ) const
+{
+    const int side = CHUNK_SIZE + 1;
+    const int chunkSize = CHUNK_SIZE; //std::min takes a reference, which CHUNK_SIZE can't give
 
-    m_normals.resize(m_vertices.size()); //We want a normal for each vertex
-    shareCount.resize(m_vertices.size());
+    int localMinX = std::max(minX - chunk.startX, 0);
+    int localMinZ = std::max(minZ - chunk.startZ, 0);
+    int localMaxX = std::min(maxX - chunk.startX, chunkSize);
+    int localMaxZ = std::min(maxZ - chunk.startZ, chunkSize);
 
-    for (unsigned int i = 0; i < shareCount.size(); ++i)
+    if (localMinX > localMaxX || localMinZ > localMaxZ)
     {
-        shareCount[i] = 0;
+        return;
     }
 
-    unsigned int numTriangles = m_indices.size() / 3;
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vertexBuffer);
 
-    faceNormals.resize(numTriangles); //One normal per triangle
+    vector<TerrainVertex> vertices((localMaxZ - localMinZ + 1) * side);
+    int i = 0;
+    for (int z = localMinZ; z <= localMaxZ; ++z)
+    {
+        for (int x = 0; x < side; ++x, ++i)
+        {
+            buildChunkVertex(chunk, x, z, 0.0f, vertices[i]);
+        }
+    }
+
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(TerrainVertex) * localMinZ * side,
+                    sizeof(TerrainVertex) * vertices.size(), &vertices[0]);
+
+    for (int edge = 0; edge < 4; ++edge)
+    {
+        //Which part of this skirt, if any, hangs from the region
+        bool touches;
+        int first, last;
+        switch (edge)
+        {
+            case 0: touches = (localMinZ == 0); first = localMinX; last = localMaxX; break;
+            case 1: touches = (localMaxZ == CHUNK_SIZE); first = localMinX; last = localMaxX; break;
+            case 2: touches = (localMinX == 0); first = localMinZ; last = localMaxZ; break;
+            default: touches = (localMaxX == CHUNK_SIZE); first = localMinZ; last = localMaxZ; break;
+        }
+
+        if (!touches)
+        {
+            continue;
+        }
+
+        vertices.resize(last - first + 1);
+        for (int j = first; j <= last; ++j)
+        {
+            int x, z;
+            getEdgeVertex(edge, j, CHUNK_SIZE, x, z);
+            buildChunkVertex(chunk, x, z, m_skirtDepth, vertices[j - first]);
+        }
+
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(TerrainVertex) * ((side * side) + (edge * side) + first),
+                        sizeof(TerrainVertex) * vertices.size(), &vertices[0]);
+    }
+}
+
+/**
+    Turns strips separated by RESTART_INDEX into one long strip, for GL
+    versions without primitive restart. Each strip is joined to the next
+    by repeating the vertices either side of the gap, which only makes
+    triangles with no area. A strip flips its winding every triangle, so
+    every strip is started on an even index to keep it facing the same
+    way it did on its own.
+*/
+static void joinStrips(const GLushort* indices, unsigned int count, vector<GLushort>& joined)
+{
+    joined.clear();
+
+    bool startingStrip = true;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (indices[i] == RESTART_INDEX)
+        {
+            startingStrip = true;
+            continue;
+        }
+
+        if (startingStrip && !joined.empty())
+        {
+            joined.push_back(joined.back());
+            joined.push_back(indices[i]);
+            if (joined.size() % 2 != 0)
+            {
+                joined.push_back(indices[i]);
+            }
+        }
+
+        startingStrip = false;
+        joined.push_back(indices[i]);
+    }
+}
+
+void Terrain::generateChunkIndices()
+{
+    m_usePrimitiveRestart = (GLEW_VERSION_3_1 != 0);
+
+    m_levelIndexBuffers.resize(m_levelCount);
+    m_levelIndexCounts.resize(m_levelCount);
+    glGenBuffers(m_levelCount, &m_levelIndexBuffers[0]);
+
+    vector<GLushort> indices;
+    vector<GLushort> joined;
+    for (int level = 0; level < m_levelCount; ++level)
+    {
+        //The cache and buildLevelIndices() both separate the strips with RESTART_INDEX
+        const GLushort* levelIndices;
+        unsigned int levelIndexCount;
+        if (m_cache.get())
+        {
+            levelIndices = m_cache->getLevelIndices(level);
+            levelIndexCount = m_cache->getLevelIndexCount(level);
+        }
+        else
+        {
+            buildLevelIndices(level, indices);
+            levelIndices = &indices[0];
+            levelIndexCount = indices.size();
+        }
+
+        if (!m_usePrimitiveRestart)
+        {
+            joinStrips(levelIndices, levelIndexCount, joined);
+            levelIndices = &joined[0];
+            levelIndexCount = joined.size();
+        }
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_levelIndexBuffers[level]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * levelIndexCount, levelIndices, GL_STATIC_DRAW);
+        m_levelIndexCounts[level] = levelIndexCount;
+    }
+}
+
+/**
+    Builds the triangle strips for one level of detail. A level only uses
+    every (1 << level)th vertex, and its skirts join the same edge
+    vertices to the ones hanging below them. Each row of a band and each
+    skirt is its own strip, separated by RESTART_INDEX. The baked cache
+    keeps them like this too, generateChunkIndices() joins them up if
+    primitive restart isn't supported.
+*/
+void Terrain::buildLevelIndices(int level, vector<GLushort>& indices) const
+{
+    const int side = CHUNK_SIZE + 1;
+    const int skirtStart = side * side;
+    const int step = 1 << level;
+    const int bandWidth = STRIP_BAND_WIDTH * step;
+    const int chunkSize = CHUNK_SIZE; //std::min takes a reference, which CHUNK_SIZE can't give
+
+    indices.clear();
+
+    for (int bandStart = 0; bandStart < CHUNK_SIZE; bandStart += bandWidth)
+    {
+        int bandEnd = std::min(bandStart + bandWidth, chunkSize);
+
+        for (int z = 0; z < CHUNK_SIZE; z += step)
+        {
+            /*
+                Alternating between the rows gives two triangles per square,
+                split from its bottom left corner to its top right
+            */
+            for (int x = bandStart; x <= bandEnd; x += step)
+            {
+                indices.push_back((z * side) + x);
+                indices.push_back(((z + step) * side) + x);
+            }
+            indices.push_back(RESTART_INDEX);
+        }
+    }
 
-    for (unsigned int i = 0; i < numTriangles; ++i)
+    /*
+        Each skirt is walked so that its triangles face out of the chunk,
+        anticlockwise looking down on the terrain. The top and right
+        edges run backwards.
+    */
+    for (int edge = 0; edge < 4; ++edge)
     {
-        Vertex* v1 = &m_vertices[m_indices[i*3]];
-        Vertex* v2 = &m_vertices[m_indices[(i*3)+1]];
-        Vertex* v3 = &m_vertices[m_indices[(i*3)+2]];
+        const bool backwards = (edge == 0 || edge == 3);
+
+        for (int i = 0; i <= CHUNK_SIZE; i += step)
+        {
+            int along = backwards ? CHUNK_SIZE - i : i;
+
+            int x, z;
+            getEdgeVertex(edge, along, CHUNK_SIZE, x, z);
+            indices.push_back((z * side) + x);
+            indices.push_back(skirtStart + (edge * side) + along);
+        }
+        indices.push_back(RESTART_INDEX);
+    }
+}
 
-        Vertex vec1, vec2;
+/**
+    Called when the heights change, resends any chunks that are on the GPU
+*/
+void Terrain::updateChunks()
+{
+    updateChunkBounds();
+
+    if (m_isDisplaced)
+    {
+        uploadHeightField(0, 0, m_width - 1, m_width - 1);
+        return;
+    }
+
+    for (vector<Chunk>::iterator chunk = m_chunks.begin(); chunk != m_chunks.end(); ++chunk)
+    {
+        //Nothing to update if the terrain hasn't been sent to OpenGL yet
+        if ((*chunk).vertexBuffer)
+        {
+            uploadChunk(*chunk);
+        }
+    }
+}
+
+bool Terrain::isDisplacementSupported() const
+{
+    //A tiled heightmap is never all in memory, so it can't go in one texture
+    if (!getHeightData() || !GLEW_VERSION_3_0 || !GLSLProgram::glsl130Supported())
+    {
+        return false;
+    }
+
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    return m_width <= maxTextureSize;
+}
+
+/**
+    Sends the heights to a float texture, one texel per grid position, and
+    builds the flat patch the chunks are drawn from. The normals, texture
+    coordinates and so on are worked out by the shader, so they're freed.
+*/
+void Terrain::initializeDisplacement()
+{
+    glGenTextures(1, &m_heightFieldTexID);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, m_heightFieldTexID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, m_width, m_width, 0, GL_RED, GL_FLOAT, getHeightData());
+    glActiveTexture(GL_TEXTURE0);
+
+    const int side = CHUNK_SIZE + 1;
+    vector<PatchVertex> vertices((side * side) + (4 * side));
+
+    int i = 0;
+    for (int z = 0; z < side; ++z)
+    {
+        for (int x = 0; x < side; ++x, ++i)
+        {
+            vertices[i].x = (GLubyte)x;
+            vertices[i].z = (GLubyte)z;
+            vertices[i].skirt = 0;
+            vertices[i].padding = 0;
+        }
+    }
+
+    for (int edge = 0; edge < 4; ++edge)
+    {
+        for (int j = 0; j < side; ++j, ++i)
+        {
+            int x, z;
+            getEdgeVertex(edge, j, CHUNK_SIZE, x, z);
+            vertices[i].x = (GLubyte)x;
+            vertices[i].z = (GLubyte)z;
+            vertices[i].skirt = 1;
+            vertices[i].padding = 0;
+        }
+    }
+
+    glGenBuffers(1, &m_patchVertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_patchVertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(PatchVertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+
+    vector<Vertex>().swap(m_normals);
+    vector<float>().swap(m_heightTexCoords);
+    vector<TexCoord>().swap(m_texCoords);
+    vector<Color>().swap(m_colors);
+
+    m_isDisplaced = true;
+}
+
+//Sends the heights of the grid positions given (inclusive) to the height texture again
+void Terrain::uploadHeightField(int minX, int minZ, int maxX, int maxZ) const
+{
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, m_heightFieldTexID);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, m_width);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, minX, minZ, maxX - minX + 1, maxZ - minZ + 1, GL_RED, GL_FLOAT,
+                    getHeightData() + (minZ * m_width) + minX);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+float Terrain::getChunkDistance(const Chunk& chunk, const Vertex& eye) const
+{
+    //Distance to the nearest point of the chunk, so the one we're standing on is always at full detail
+    float dx = std::max(std::max(chunk.minBounds.x - eye.x, eye.x - chunk.maxBounds.x), 0.0f);
+    float dy = std::max(std::max(chunk.minBounds.y - eye.y, eye.y - chunk.maxBounds.y), 0.0f);
+    float dz = std::max(std::max(chunk.minBounds.z - eye.z, eye.z - chunk.maxBounds.z), 0.0f);
+    return sqrtf((dx * dx) + (dy * dy) + (dz * dz));
+}
+
+int Terrain::getChunkLevel(const Chunk& chunk, const Vertex& eye) const
+{
+    float distance = getChunkDistance(chunk, eye);
+
+    int level = 0;
+    float limit = LOD_DISTANCE;
+    while (level < m_levelCount - 1 && distance >= limit)
+    {
+        ++level;
+        limit *= 2.0f;
+    }
 
-        vec1.x = v2->x - v1->x;
-        vec1.y = v2->y - v1->y;
-        vec1.z = v2->z - v1->z;
+    return level;
+}
 
-        vec2.x = v3->x - v1->x;
-        vec2.y = v3->y - v1->y;
-        vec2.z = v3->z - v1->z;
+/**
+    Pages in the chunks around the camera, nearest first, and drops the
+    least recently used ones when there are more than we want to keep
+*/
+void Terrain::updateResidentChunks(const Vertex& eye) const
+{
+    vector<std::pair<float, int> > missing;
 
-        Vertex* normal = &faceNormals[i];
-        crossProduct(normal, &vec1, &vec2); //Calculate the normal
-        normalize(normal);
+    for (unsigned int i = 0; i < m_chunks.size(); ++i)
+    {
+        Chunk& chunk = m_chunks[i];
+        float distance = getChunkDistance(chunk, eye);
+        if (distance >= STREAMING_DISTANCE)
+        {
+            continue;
+        }
 
-        for (int j = 0; j < 3; ++j)
+        if (chunk.vertexBuffer)
         {
-            int index = m_indices[(i*3)+j];
-            m_normals[index].x += normal->x;
-            m_normals[index].y += normal->y;
-            m_normals[index].z += normal->z;
-            shareCount[index]++;
+            //Still wanted, move it to the front
+            m_residentChunks.splice(m_residentChunks.begin(), m_residentChunks, chunk.residentPosition);
+        }
+        else
+        {
+            missing.push_back(std::make_pair(distance, (int)i));
         }
     }
 
-    for (unsigned int i = 0; i < m_vertices.size(); ++i)
+    std::sort(missing.begin(), missing.end());
+
+    int uploads = std::min((int)missing.size(), MAX_CHUNK_UPLOADS_PER_FRAME);
+    for (int i = 0; i < uploads; ++i)
     {
-        m_normals[i].x = m_normals[i].x / shareCount[i];
-        m_normals[i].y = m_normals[i].y / shareCount[i];
-        m_normals[i].z = m_normals[i].z / shareCount[i];
-        normalize(&m_normals[i]);
+        Chunk& chunk = m_chunks[missing[i].second];
+        uploadChunk(chunk);
+        m_residentChunks.push_front(missing[i].second);
+        chunk.residentPosition = m_residentChunks.begin();
     }
 
-    glGenBuffers(1, &m_normalBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_normalBuffer); //Bind the vertex buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * m_normals.size() * 3, &m_normals[0], GL_STATIC_DRAW); //Send the data to OpenGL
+    while (m_residentChunks.size() > MAX_RESIDENT_CHUNKS)
+    {
+        evictChunk(m_residentChunks.back());
+    }
+}
+
+void Terrain::evictChunk(int index) const
+{
+    Chunk& chunk = m_chunks[index];
+
+    glDeleteBuffers(1, &chunk.vertexBuffer);
+    chunk.vertexBuffer = 0;
+    m_residentChunks.erase(chunk.residentPosition);
 }
 
 void Terrain::SetMVP(float *mvp)
@@ -266,103 +1007,281 @@ void Terrain::generateTexCoords(int width)
             float t = (float(z) / float(width)) * 8.0f;
             m_texCoords.push_back(TexCoord(s, t));
 
-            //Get the height at this vertex
-            float h = m_vertices[(z * width) + x].y;
-            if (h > maxHeight) maxHeight = h;
-            if (h < minHeight) minHeight = h;
-            m_heightTexCoords.push_back(h);
-        }
+            //Get the height at this vertex
+            float h = m_heights[(z * width) + x];
+            if (h > maxHeight) maxHeight = h;
+            if (h < minHeight) minHeight = h;
+            m_heightTexCoords.push_back(h);
+        }
+    }
+
+    //We scale the heights between 0.0 and 1.0 using the max height and min height
+    m_heightTexScale = 1.0f / (maxHeight - minHeight);
+    m_heightTexOffset = minHeight / (maxHeight - minHeight);
+
+    for (vector<float>::iterator height = m_heightTexCoords.begin();
+        height != m_heightTexCoords.end(); ++height)
+    {
+       (*height) = ((*height) * m_heightTexScale) + m_heightTexOffset;
+    }
+}
+
+void Terrain::generateWaterTexCoords(int width)
+{
+    m_waterTexCoords.push_back(TexCoord(0.0f, 0.0f));
+    m_waterTexCoords.push_back(TexCoord(0.0f, 16.0f));
+    m_waterTexCoords.push_back(TexCoord(16.0f, 16.0f));
+    m_waterTexCoords.push_back(TexCoord(16.0f, 0.0f));
+
+    /*int waterWidth = (int)sqrtf((float)m_waterVertices.size());
+
+    for (int z = 0; z < waterWidth; ++z)
+    {
+        for (int x = 0; x < waterWidth; ++x)
+        {
+            float s = (float(x) / float(width)) * 32.0f;
+            float t = (float(z) / float(width)) * 32.0f;
+            m_waterTexCoords.push_back(TexCoord(s, t));
+        }
+    }*/
+}
+
+/**
+    Reads the heightmap and builds the terrain geometry. Only system memory
+    is touched here, call initializeGraphics() afterwards to draw it.
+
+    A width of 0 works it out from the size of the file, which must be square.
+*/
+bool Terrain::loadHeightmap(const string& rawFile, int width, bool generateWater)
+{
+    const float HEIGHT_SCALE = 10.0f;
+    std::ifstream fileIn(rawFile.c_str(), std::ios::binary);
+
+    if (!fileIn.good())
+    {
+        std::cout << "File does not exist" << std::endl;
+        return false;
+    }
+
+    //This line reads in the whole file into a string
+    string stringBuffer(std::istreambuf_iterator<char>(fileIn), (std::istreambuf_iterator<char>()));
+
+    fileIn.close();
+
+    if (width == 0)
+    {
+        width = (int)(sqrtf((float)stringBuffer.size()) + 0.5f);
+    }
+
+    if (stringBuffer.size() != (width * width))
+    {
+        std::cout << "Image size does not match passed width" << std::endl;
+        return false;
+    }
+
+    if (width <= CHUNK_SIZE || (width - 1) % CHUNK_SIZE != 0)
+    {
+        std::cout << "The heightmap width must be a multiple of " << CHUNK_SIZE << " plus one" << std::endl;
+        return false;
+    }
+
+    vector<float> heights;
+    heights.reserve(width * width); //Reserve some space (faster)
+
+    //Go through the string converting each character to a float and scale it
+    for (int i = 0; i < (width * width); ++i)
+    {
+        //Convert to floating value, the unsigned char cast is importantant otherwise the values wrap at 128
+        float value = (float)(unsigned char)stringBuffer[i] / 256.0f;
+
+        heights.push_back(value * HEIGHT_SCALE);
+        m_colors.push_back(Color(value, value, value, 1.0f));
+    }
+
+    storeHeights(heights, width);
+    generateTexCoords(width);
+    generateNormals();
+
+    if (generateWater)
+    {
+        generateWaterVertices(width);
+        generateWaterIndices(width);
+        generateWaterTexCoords(width);
+    }
+
+    generateChunks();
+
+    return true;
+}
+
+/**
+    Opens a tiled heightmap (see TiledHeightmap). Unlike loadHeightmap()
+    nothing is built up front, the chunks are generated from the mapped
+    heights as they're paged in.
+*/
+bool Terrain::loadTiledHeightmap(const string& tiledFile, bool generateWater)
+{
+    std::auto_ptr<TiledHeightmap> tiles(new TiledHeightmap());
+    if (!tiles->open(tiledFile))
+    {
+        return false;
+    }
+
+    if (tiles->getTileSize() != CHUNK_SIZE)
+    {
+        std::cout << "The heightmap's tiles must be " << CHUNK_SIZE << " quads across" << std::endl;
+        return false;
     }
 
-    //We scale the heights between 0.0 and 1.0 using the max height and min height
-    for (vector<float>::iterator height = m_heightTexCoords.begin();
-        height != m_heightTexCoords.end(); ++height)
+    m_tiles = tiles;
+    m_width = m_tiles->getWidth();
+    m_heightScale = 1.0f;
+
+    float halfWidth = float(m_width) * 0.5f;
+    m_minX = -halfWidth;
+    m_maxX = halfWidth;
+    m_minZ = -halfWidth;
+    m_maxZ = halfWidth;
+
+    if (generateWater)
     {
-       (*height) = (minHeight + (*height)) / (maxHeight - minHeight);
+        generateWaterVertices(m_width);
+        generateWaterIndices(m_width);
+        generateWaterTexCoords(m_width);
     }
 
-    glGenBuffers(1, &m_texCoordBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_texCoordBuffer); //Bind the texcoord buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * m_texCoords.size() * 2, &m_texCoords[0], GL_STATIC_DRAW); //Send the data to OpenGL
+    generateChunks();
 
-    glGenBuffers(1, &m_heightTexCoordBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_heightTexCoordBuffer); //Bind the tex coord
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * m_heightTexCoords.size(), &m_heightTexCoords[0], GL_STATIC_DRAW); //Send the data to OpenGL
+    return true;
 }
 
-void Terrain::generateWaterTexCoords(int width)
+/**
+    Loads a .raw heightmap, normalizes it and multiplies the heights by
+    heightScale. The finished terrain is baked into cacheFile, and as long
+    as neither the heightmap nor the settings change later runs map the
+    cache and skip building it.
+*/
+bool Terrain::loadBakedHeightmap(const string& rawFile, float heightScale, const string& cacheFile,
+                                 bool generateWater)
 {
-    m_waterTexCoords.push_back(TexCoord(0.0f, 0.0f));
-    m_waterTexCoords.push_back(TexCoord(0.0f, 16.0f));
-    m_waterTexCoords.push_back(TexCoord(16.0f, 16.0f));
-    m_waterTexCoords.push_back(TexCoord(16.0f, 0.0f));
+    MappedFile source;
+    if (!source.open(rawFile))
+    {
+        std::cout << "File does not exist" << std::endl;
+        return false;
+    }
 
-    /*int waterWidth = (int)sqrtf((float)m_waterVertices.size());
+    int width = (int)(sqrtf((float)source.getSize()) + 0.5f);
+    const int chunkSize = CHUNK_SIZE;
 
-    for (int z = 0; z < waterWidth; ++z)
+    unsigned long long hash = TerrainCache::hash(source.getData(), source.getSize());
+    hash = TerrainCache::hash(&width, sizeof(width), hash);
+    hash = TerrainCache::hash(&heightScale, sizeof(heightScale), hash);
+    hash = TerrainCache::hash(&chunkSize, sizeof(chunkSize), hash);
+
+    source.close();
+
+    std::auto_ptr<TerrainCache> cache(new TerrainCache());
+    if (cache->open(cacheFile, hash) && cache->getWidth() == width && cache->getChunkSize() == CHUNK_SIZE)
     {
-        for (int x = 0; x < waterWidth; ++x)
+        m_cache = cache;
+        m_width = width;
+        m_normalScale = m_cache->getNormalScale();
+        m_heightTexScale = m_cache->getHeightTexScale();
+        m_heightTexOffset = m_cache->getHeightTexOffset();
+
+        float halfWidth = float(m_width) * 0.5f;
+        m_minX = -halfWidth;
+        m_maxX = halfWidth;
+        m_minZ = -halfWidth;
+        m_maxZ = halfWidth;
+
+        if (generateWater)
         {
-            float s = (float(x) / float(width)) * 32.0f;
-            float t = (float(z) / float(width)) * 32.0f;
-            m_waterTexCoords.push_back(TexCoord(s, t));
+            generateWaterVertices(m_width);
+            generateWaterIndices(m_width);
+            generateWaterTexCoords(m_width);
         }
-    }*/
 
-    glGenBuffers(1, &m_waterTexCoordsBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_waterTexCoordsBuffer); //Bind the vertex buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * m_waterTexCoords.size() * 2, &m_waterTexCoords[0], GL_STATIC_DRAW); //Send the data to OpenGL
-}
+        generateChunks();
+        if ((int)m_chunks.size() == m_cache->getChunkCount() && m_levelCount == m_cache->getLevelCount())
+        {
+            return true;
+        }
 
-bool Terrain::loadHeightmap(const string& rawFile, const string& grassTexture, const string& heightTexture, int width, bool generateWater, const string& waterTexture)
-{
-    const float HEIGHT_SCALE = 10.0f;
-    std::ifstream fileIn(rawFile.c_str(), std::ios::binary);
+        //Shouldn't happen unless the file was tampered with, build it instead
+        m_cache.reset();
+        m_waterVertices.clear();
+        m_waterIndices.clear();
+        m_waterTexCoords.clear();
+    }
 
-    if (!fileIn.good())
+    if (!loadHeightmap(rawFile, width, generateWater))
     {
-        std::cout << "File does not exist" << std::endl;
         return false;
     }
 
-    //This line reads in the whole file into a string
-    string stringBuffer(std::istreambuf_iterator<char>(fileIn), (std::istreambuf_iterator<char>()));
-
-    fileIn.close();
+    normalizeTerrain();
+    scaleHeights(heightScale);
 
-    if (stringBuffer.size() != (width * width))
+    //Not being able to save the cache only costs us time on the next run
+    if (!bakeCache(cacheFile, hash))
     {
-        std::cout << "Image size does not match passed width" << std::endl;
-        return false;
+        std::cerr << "Could not bake the terrain into " << cacheFile << std::endl;
     }
 
-    vector<float> heights;
-    heights.reserve(width * width); //Reserve some space (faster)
+    return true;
+}
 
-    //Go through the string converting each character to a float and scale it
-    for (int i = 0; i < (width * width); ++i)
+bool Terrain::bakeCache(const string& cacheFile, unsigned long long hash) const
+{
+    vector<float> chunkMinHeights;
+    vector<float> chunkMaxHeights;
+    vector<TerrainVertex> vertices;
+    vector<TerrainVertex> chunkVertices;
+
+    for (vector<Chunk>::const_iterator chunk = m_chunks.begin(); chunk != m_chunks.end(); ++chunk)
     {
-        //Convert to floating value, the unsigned char cast is importantant otherwise the values wrap at 128
-        float value = (float)(unsigned char)stringBuffer[i] / 256.0f;
+        chunkMinHeights.push_back((*chunk).minBounds.y);
+        chunkMaxHeights.push_back((*chunk).maxBounds.y);
 
-        heights.push_back(value * HEIGHT_SCALE);
-        m_colors.push_back(Color(value, value, value, 1.0f));
+        buildChunkVertices(*chunk, chunkVertices);
+        vertices.insert(vertices.end(), chunkVertices.begin(), chunkVertices.end());
     }
 
-    glGenBuffers(1, &m_colorBuffer); //Generate a buffer for the colors
-    glBindBuffer(GL_ARRAY_BUFFER, m_colorBuffer); //Bind the color buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Color) * m_colors.size(), &m_colors[0], GL_STATIC_DRAW); //Send the data to OpenGL
+    vector<vector<unsigned short> > levelIndices(m_levelCount);
+    for (int level = 0; level < m_levelCount; ++level)
+    {
+        buildLevelIndices(level, levelIndices[level]);
+    }
 
-    generateVertices(heights, width);
-    generateIndices(width);
-    generateTexCoords(width);
-    generateNormals();
+    return TerrainCache::write(cacheFile, hash, m_width, CHUNK_SIZE, m_normalScale, m_heightTexScale,
+                               m_heightTexOffset, m_heights, chunkMinHeights,
+                               chunkMaxHeights, vertices, levelIndices);
+}
 
-    if (generateWater)
+/**
+    Sends the geometry built by loadHeightmap() to OpenGL and loads
+    the textures and shaders needed to draw it.
+*/
+bool Terrain::initializeGraphics(const string& grassTexture, const string& heightTexture, const string& waterTexture)
+{
+    //The chunks themselves are paged in as they're needed
+    generateChunkIndices();
+
+    if (!m_waterVertices.empty())
     {
-        generateWaterVertices(width);
-        generateWaterIndices(width);
-        generateWaterTexCoords(width);
+        glGenBuffers(1, &m_waterVertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_waterVertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * m_waterVertices.size() * 3, &m_waterVertices[0], GL_STATIC_DRAW);
+
+        glGenBuffers(1, &m_waterIndexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_waterIndexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * m_waterIndices.size(), &m_waterIndices[0], GL_STATIC_DRAW);
+
+        glGenBuffers(1, &m_waterTexCoordsBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_waterTexCoordsBuffer); //Bind the vertex buffer
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * m_waterTexCoords.size() * 2, &m_waterTexCoords[0], GL_STATIC_DRAW); //Send the data to OpenGL
 
         if (!m_waterTexture.load(waterTexture))
         {
@@ -370,6 +1289,7 @@ bool Terrain::loadHeightmap(const string& rawFile, const string& grassTexture, c
             return false;
         }
 
+        m_waterShaderProgram = new GLSLProgram(m_waterVertexShader, m_waterFragmentShader);
         if (!m_waterShaderProgram->initialize())
         {
             std::cerr << "Could not initialize the water shader" << std::endl;
@@ -395,8 +1315,6 @@ bool Terrain::loadHeightmap(const string& rawFile, const string& grassTexture, c
 
     }
 
-    m_width = width;
-
     if (!m_grassTexture.load(grassTexture))
     {
         std::cerr << "Could not load the grass texture" << std::endl;
@@ -431,22 +1349,50 @@ bool Terrain::loadHeightmap(const string& rawFile, const string& grassTexture, c
                       0, GL_RGB, GL_UNSIGNED_BYTE,
                       m_heightTexture.getImageData());
 
-    if (!m_shaderProgram->initialize())
+    bool displace = m_displacementEnabled && isDisplacementSupported();
+    if (displace)
     {
-        std::cerr << "Could not initialize the terrain's shader" << std::endl;
-        return false;
+        m_shaderProgram = new GLSLProgram(DISPLACED_VERTEX_SHADER, DISPLACED_FRAGMENT_SHADER);
+        if (!m_shaderProgram->initialize())
+        {
+            //The chunks are all still there to draw instead
+            std::cerr << "Could not initialize the displaced terrain's shader, drawing it in chunks" << std::endl;
+            delete m_shaderProgram;
+            m_shaderProgram = NULL;
+            displace = false;
+        }
+    }
+
+    if (!displace)
+    {
+        m_shaderProgram = new GLSLProgram(m_vertexShader, m_fragmentShader);
+        if (!m_shaderProgram->initialize())
+        {
+            std::cerr << "Could not initialize the terrain's shader" << std::endl;
+            return false;
+        }
     }
 
 	m_shaderProgram->bindAttrib(0, "a_Vertex");
-    m_shaderProgram->bindAttrib(1, "a_TexCoord0");
-    m_shaderProgram->bindAttrib(2, "a_Normal");
-    m_shaderProgram->bindAttrib(3, "a_TexCoord1");
+    if (!displace)
+    {
+        m_shaderProgram->bindAttrib(1, "a_TexCoord0");
+        m_shaderProgram->bindAttrib(2, "a_Normal");
+        m_shaderProgram->bindAttrib(3, "a_TexCoord1");
+    }
     m_shaderProgram->linkProgram();
     m_shaderProgram->bindShader();
 
     m_shaderProgram->sendUniform("texture0", 0);
     m_shaderProgram->sendUniform("texture1", 1); //Set the uniform for the height texture
 
+    if (displace)
+    {
+        initializeDisplacement();
+        m_shaderProgram->sendUniform("heightfield", 2);
+        m_shaderProgram->sendUniform("grid_width", m_width);
+    }
+
     //Send the lighting properties
     m_shaderProgram->sendUniform("material_ambient", 0.4f, 0.8f, 0.4f, 1.0f);
     m_shaderProgram->sendUniform("material_diffuse", 0.8f, 0.8f, 0.8f, 1.0f);
@@ -461,10 +1407,12 @@ bool Terrain::loadHeightmap(const string& rawFile, const string& grassTexture, c
     return true;
 }
 
-Vertex Terrain::getPositionAt(int x, int z)
+Vertex Terrain::getPositionAt(int x, int z) const
 {
-    assert((z * m_width) + x < (int)m_vertices.size());
-    return m_vertices[(z * m_width) + x];
+    assert(x >= 0 && z >= 0 && x < m_width && z < m_width);
+
+    float halfWidth = float(m_width) * 0.5f;
+    return Vertex(float(x) - halfWidth, getGridHeight(x, z), float(z) - halfWidth);
 }
 
 void Terrain::renderWater(float mvp[]) const
@@ -517,6 +1465,8 @@ void Terrain::renderWater(float mvp[]) const
 
 void Terrain::render(float mvp[]) const
 {
+    PROFILE_ZONE("Terrain::render");
+
     glEnable(GL_CULL_FACE);
     glEnable(GL_DEPTH_TEST);
 
@@ -538,10 +1488,7 @@ void Terrain::render(float mvp[]) const
     m_shaderProgram->sendUniform4x4("projection_matrix", project);
     m_shaderProgram->sendUniform3x3("normal_matrix", &normalMatrix[0]);
 
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
+    m_shaderProgram->sendUniform("texcoord_scale", TEXCOORD_SCALE);
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, m_grassTexID);
@@ -549,41 +1496,118 @@ void Terrain::render(float mvp[]) const
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_1D, m_heightTexID);
 
+    //The camera position for picking each chunk's level of detail
+    glm::mat4 modelview = glm::make_mat4(mvp);
+    glm::vec4 eyePosition = glm::inverse(modelview)[3];
+    Vertex eye(eyePosition.x, eyePosition.y, eyePosition.z);
 
-    //Bind the vertex array and set the vertex pointer to point at it
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-    //glVertexPointer(3, GL_FLOAT, 0, 0);
-    glVertexAttribPointer((GLint)0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glm::mat4 clip = glm::make_mat4(project) * modelview;
+    Frustum frustum;
+    frustum.updateFrustum(glm::value_ptr(clip));
+
+    if (m_isDisplaced)
+    {
+        //Every chunk is the same patch, only where it is and its detail change
+        m_shaderProgram->sendUniform("eye_position", eye.x, eye.y, eye.z);
+        m_shaderProgram->sendUniform("skirt_depth", m_skirtDepth);
+        m_shaderProgram->sendUniform("normal_scale", m_normalScale);
+        m_shaderProgram->sendUniform("height_texcoord", m_heightTexScale, m_heightTexOffset);
+
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, m_heightFieldTexID);
+
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, m_patchVertexBuffer);
+        glVertexAttribPointer((GLint)0, 3, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(PatchVertex), 0);
+    }
+    else
+    {
+        //Undoes the vertex quantization, only the chunk's corner changes per chunk
+        m_shaderProgram->sendUniform("position_scale", 1.0f, m_heightQuantStep, 1.0f);
 
-    //Bind the color array
-  //  glBindBuffer(GL_ARRAY_BUFFER, m_colorBuffer);
-    //glColorPointer(3, GL_FLOAT, 0, 0);
-  //  glVertexAttribPointer((GLint)1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glEnableVertexAttribArray(3);
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_texCoordBuffer);
-    glVertexAttribPointer((GLint)1, 2, GL_FLOAT, GL_FALSE, 0, 0);
+        updateResidentChunks(eye);
+    }
+
+    if (m_usePrimitiveRestart)
+    {
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(RESTART_INDEX);
+    }
+
+    for (vector<Chunk>::const_iterator chunk = m_chunks.begin(); chunk != m_chunks.end(); ++chunk)
+    {
+        const Vertex& minBounds = (*chunk).minBounds;
+        const Vertex& maxBounds = (*chunk).maxBounds;
+
+        Vertex center = (minBounds + maxBounds) * 0.5f;
+        float dx = maxBounds.x - center.x;
+        float dy = maxBounds.y - center.y;
+        float dz = maxBounds.z - center.z;
+        float radius = sqrtf((dx * dx) + (dy * dy) + (dz * dz));
+
+        if ((!m_isDisplaced && !(*chunk).vertexBuffer) ||
+            !frustum.sphereInFrustum(center.x, center.y, center.z, radius))
+        {
+            continue;
+        }
+
+        int level = getChunkLevel(*chunk, eye);
+
+        if (m_isDisplaced)
+        {
+            /*
+                The vertices have finished sliding into the next level by
+                the time the chunk is far enough away to switch to it. The
+                last level has nothing to morph into.
+            */
+            float morphEnd = LOD_DISTANCE * float(1 << level);
+            float morphStart = morphEnd * LOD_MORPH_START;
+            float morphScale = (level < m_levelCount - 1) ? 1.0f / (morphEnd - morphStart) : 0.0f;
+
+            m_shaderProgram->sendUniform("chunk_start", float((*chunk).startX), float((*chunk).startZ));
+            m_shaderProgram->sendUniform("lod_step", float(1 << level));
+            m_shaderProgram->sendUniform("morph_start", morphStart);
+            m_shaderProgram->sendUniform("morph_scale", morphScale);
+
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_levelIndexBuffers[level]);
+            glDrawElements(GL_TRIANGLE_STRIP, m_levelIndexCounts[level], GL_UNSIGNED_SHORT, 0);
+            continue;
+        }
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_normalBuffer);
-    glVertexAttribPointer((GLint)2, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        m_shaderProgram->sendUniform("position_offset", minBounds.x, m_heightQuantMin, minBounds.z);
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_heightTexCoordBuffer);
-    glVertexAttribPointer((GLint)3, 1, GL_FLOAT, GL_FALSE, 0, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, (*chunk).vertexBuffer);
+        glVertexAttribPointer((GLint)0, 3, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(TerrainVertex), (const GLvoid*)offsetof(TerrainVertex, x));
+        glVertexAttribPointer((GLint)1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(TerrainVertex), (const GLvoid*)offsetof(TerrainVertex, s));
+        glVertexAttribPointer((GLint)2, 2, GL_SHORT, GL_TRUE, sizeof(TerrainVertex), (const GLvoid*)offsetof(TerrainVertex, normalX));
+        glVertexAttribPointer((GLint)3, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(TerrainVertex), (const GLvoid*)offsetof(TerrainVertex, height));
 
-    //Bind the index array
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_levelIndexBuffers[level]);
+        glDrawElements(GL_TRIANGLE_STRIP, m_levelIndexCounts[level], GL_UNSIGNED_SHORT, 0);
+    }
 
-    //Draw the triangles
-    glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0);
+    if (m_usePrimitiveRestart)
+    {
+        glDisable(GL_PRIMITIVE_RESTART);
+    }
 
     glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
-    glDisableVertexAttribArray(2);
-    glDisableVertexAttribArray(3);
+    if (!m_isDisplaced)
+    {
+        glDisableVertexAttribArray(1);
+        glDisableVertexAttribArray(2);
+        glDisableVertexAttribArray(3);
+    }
 
     glActiveTexture(GL_TEXTURE0);
 }
 
-GLfloat Terrain::getHeightAt(GLfloat x, GLfloat z)
+GLfloat Terrain::getHeightAt(GLfloat x, GLfloat z) const
 {
     float halfWidth = float(m_width) * 0.5f;
 
@@ -596,68 +1620,370 @@ GLfloat Terrain::getHeightAt(GLfloat x, GLfloat z)
     int x0 = (int)floor(scaledX);
     int z0 = (int)floor(scaledZ);
 
-/*
-    Get the 4 points surrounding the position passed in
-*/
-    int p0 = (z0 * m_width + x0);
-    int p1 = ((z0 * m_width + x0) + 1);
-    int p2 = ((z0 + 1) * m_width + x0);
-    int p3 = ((z0 + 1) * m_width + x0 + 1);
-
     float fracX = scaledX - (float)x0;
     float fracZ = scaledZ - (float)z0;
 
 /*
     If we are outside the bounds of the map, just return zero as the height
 */
-    if (p0 >= (int)m_vertices.size() ||
-		p1 >= (int)m_vertices.size() ||
-		p2 >= (int)m_vertices.size() ||
-		p3 >= (int)m_vertices.size() ||
-		p0 < 0 || p1 < 0 || p2 < 0 || p3 < 0)
+    if (x0 < 0 || z0 < 0 || x0 + 1 >= m_width || z0 + 1 >= m_width)
     {
         return 0.0f;
     }
 
+/*
+    Get the 4 points surrounding the position passed in
+*/
+    float h0 = getGridHeight(x0, z0);
+    float h1 = getGridHeight(x0 + 1, z0);
+    float h2 = getGridHeight(x0, z0 + 1);
+    float h3 = getGridHeight(x0 + 1, z0 + 1);
+
 /*
     Bilinearly interpolate the height values
 */
-    float xInterp0 = m_vertices[p0].y + fracX * (m_vertices[p1].y - m_vertices[p0].y);
-    float xInterp1 = m_vertices[p2].y + fracX * (m_vertices[p3].y - m_vertices[p2].y);
+    float xInterp0 = h0 + fracX * (h1 - h0);
+    float xInterp1 = h2 + fracX * (h3 - h2);
     return xInterp0 + fracZ * (xInterp1 - xInterp0);
 }
 
+/**
+    The same as calling getHeightAt() for each of the count positions, but
+    four at a time straight from the dense height array. Positions off the
+    map get a height of zero.
+*/
+void Terrain::getHeightsAt(const float* xs, const float* zs, float* heights, int count) const
+{
+    const float* data = getHeightData();
+    int i = 0;
+
+#ifdef TERRAIN_USE_SSE2
+    if (data)
+    {
+        const __m128 halfWidth = _mm_set1_ps(float(m_width) * 0.5f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128i lastCell = _mm_set1_epi32(m_width - 2);
+        const __m128i width = _mm_set1_epi32(m_width);
+
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 scaledX = _mm_add_ps(_mm_loadu_ps(xs + i), halfWidth);
+            __m128 scaledZ = _mm_add_ps(_mm_loadu_ps(zs + i), halfWidth);
+
+            //Truncation rounds negatives up, so step those back down to get floor()
+            __m128 floorX = _mm_cvtepi32_ps(_mm_cvttps_epi32(scaledX));
+            __m128 floorZ = _mm_cvtepi32_ps(_mm_cvttps_epi32(scaledZ));
+            floorX = _mm_sub_ps(floorX, _mm_and_ps(_mm_cmpgt_ps(floorX, scaledX), one));
+            floorZ = _mm_sub_ps(floorZ, _mm_and_ps(_mm_cmpgt_ps(floorZ, scaledZ), one));
+
+            __m128 fracX = _mm_sub_ps(scaledX, floorX);
+            __m128 fracZ = _mm_sub_ps(scaledZ, floorZ);
+            __m128i x0 = _mm_cvttps_epi32(floorX);
+            __m128i z0 = _mm_cvttps_epi32(floorZ);
+
+            //0 <= x0 <= width - 2 is tested as an unsigned compare by flipping the sign bits
+            const __m128i signBit = _mm_set1_epi32((int)0x80000000);
+            __m128i limit = _mm_xor_si128(lastCell, signBit);
+            __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(_mm_xor_si128(x0, signBit), limit),
+                                           _mm_cmpgt_epi32(_mm_xor_si128(z0, signBit), limit));
+
+            //Point the lanes that are off the map at the first cell, they're zeroed below
+            x0 = _mm_andnot_si128(outside, x0);
+            z0 = _mm_andnot_si128(outside, z0);
+
+            //SSE2 has no 32 bit multiply, but z0 and width fit in 16 bits so the
+            //product can be put together from the low and high halves
+            __m128i rowStart = _mm_or_si128(_mm_mullo_epi16(z0, width),
+                                            _mm_slli_epi32(_mm_mulhi_epu16(z0, width), 16));
+            __m128i index = _mm_add_epi32(rowStart, x0);
+
+            int indices[4];
+            _mm_storeu_si128((__m128i*)indices, index);
+
+            __m128 h0 = _mm_setr_ps(data[indices[0]], data[indices[1]], data[indices[2]], data[indices[3]]);
+            __m128 h1 = _mm_setr_ps(data[indices[0] + 1], data[indices[1] + 1], data[indices[2] + 1], data[indices[3] + 1]);
+            __m128 h2 = _mm_setr_ps(data[indices[0] + m_width], data[indices[1] + m_width],
+                                    data[indices[2] + m_width], data[indices[3] + m_width]);
+            __m128 h3 = _mm_setr_ps(data[indices[0] + m_width + 1], data[indices[1] + m_width + 1],
+                                    data[indices[2] + m_width + 1], data[indices[3] + m_width + 1]);
+
+            //The same sums as getHeightAt() so both give identical results
+            __m128 xInterp0 = _mm_add_ps(h0, _mm_mul_ps(fracX, _mm_sub_ps(h1, h0)));
+            __m128 xInterp1 = _mm_add_ps(h2, _mm_mul_ps(fracX, _mm_sub_ps(h3, h2)));
+            __m128 height = _mm_add_ps(xInterp0, _mm_mul_ps(fracZ, _mm_sub_ps(xInterp1, xInterp0)));
+
+            _mm_storeu_ps(heights + i, _mm_andnot_ps(_mm_castsi128_ps(outside), height));
+        }
+    }
+#endif
+
+    //Whatever is left over, or everything if the heights are in tiles
+    for (; i < count; ++i)
+    {
+        heights[i] = getHeightAt(xs[i], zs[i]);
+    }
+}
+
+bool Terrain::raycast(const Vector3& origin, const Vector3& direction, float maxDistance, Vector3& hit) const
+{
+    if (!m_quadtree.get())
+    {
+        return false;
+    }
+
+    float halfWidth = float(m_width) * 0.5f;
+    Vector3 gridOrigin(origin.x + halfWidth, origin.y, origin.z + halfWidth);
+
+    float distance;
+    if (!m_quadtree->raycast(gridOrigin, direction, maxDistance, distance))
+    {
+        return false;
+    }
+
+    hit = origin + direction * distance;
+    return true;
+}
+
+bool Terrain::segmentIntersect(const Vector3& start, const Vector3& end, Vector3& hit) const
+{
+    return raycast(start, end - start, 1.0f, hit);
+}
+
+bool Terrain::sweepSphere(const Vector3& start, const Vector3& end, float radius, float& timeOfImpact) const
+{
+    if (start.y - radius < getHeightAt(start.x, start.z))
+    {
+        timeOfImpact = 0.0f;
+        return true;
+    }
+
+    if (!m_quadtree.get())
+    {
+        return false;
+    }
+
+    //The point radius below the centre is the part that reaches the ground first
+    float halfWidth = float(m_width) * 0.5f;
+    Vector3 gridStart(start.x + halfWidth, start.y - radius, start.z + halfWidth);
+
+    float distance;
+    if (!m_quadtree->raycast(gridStart, end - start, 1.0f, distance))
+    {
+        return false;
+    }
+
+    timeOfImpact = distance;
+    return true;
+}
+
+void Terrain::getHeightRange(float minX, float minZ, float maxX, float maxZ, float& lowest, float& highest) const
+{
+    if (!m_quadtree.get())
+    {
+        lowest = highest = 0.0f;
+        return;
+    }
+
+    float halfWidth = float(m_width) * 0.5f;
+
+    //Widen the area out to the grid positions around it
+    m_quadtree->getHeightRange((int)floorf(minX + halfWidth), (int)floorf(minZ + halfWidth),
+                               (int)ceilf(maxX + halfWidth), (int)ceilf(maxZ + halfWidth), lowest, highest);
+}
+
 void Terrain::normalizeTerrain()
 {
+    if (m_cache.get())
+    {
+        std::cerr << "A baked terrain's heights are final, it can't be normalized" << std::endl;
+        return;
+    }
+
+    if (m_tiles.get())
+    {
+        //The mapped heights are read only, scale them as they're read instead
+        m_heightScale /= (m_tiles->getMaxHeight() - m_tiles->getMinHeight()) * m_heightScale;
+        updateChunks();
+        return;
+    }
+
     float miny = 1000, maxy = -1000;
 
-    for (vector<Vertex>::iterator v = m_vertices.begin();
-        v != m_vertices.end(); ++v)
+    for (vector<float>::iterator height = m_heights.begin();
+        height != m_heights.end(); ++height)
     {
-        if ((*v).y < miny) miny = (*v).y;
-        if ((*v).y > maxy) maxy = (*v).y;
+        if ((*height) < miny) miny = (*height);
+        if ((*height) > maxy) maxy = (*height);
     }
 
     float h = maxy - miny;
 
-    for (vector<Vertex>::iterator v = m_vertices.begin();
-        v != m_vertices.end(); ++v)
+    for (vector<float>::iterator height = m_heights.begin();
+        height != m_heights.end(); ++height)
     {
-        (*v).y /= h;
+        (*height) /= h;
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLfloat) * m_vertices.size() * 3, &m_vertices[0]);
+    m_normalScale *= h;
+    m_heightTexScale *= h;
+
+    updateChunks();
 }
 
 void Terrain::scaleHeights(float scale)
 {
-    for (vector<Vertex>::iterator v = m_vertices.begin();
-        v != m_vertices.end(); ++v)
+    if (m_cache.get())
+    {
+        std::cerr << "A baked terrain's heights are final, it can't be scaled" << std::endl;
+        return;
+    }
+
+    if (m_tiles.get())
+    {
+        m_heightScale *= scale;
+    }
+
+    for (vector<float>::iterator height = m_heights.begin();
+        height != m_heights.end(); ++height)
+    {
+        (*height) *= scale;
+    }
+
+    m_normalScale /= scale;
+    m_heightTexScale /= scale;
+
+    updateChunks();
+}
+
+void Terrain::deformRegion(int startX, int startZ, int columns, int rows, const float* offsets)
+{
+    if (m_tiles.get())
+    {
+        std::cerr << "A tiled terrain's heights are read only, it can't be deformed" << std::endl;
+        return;
+    }
+
+    if (m_cache.get())
+    {
+        unbakeCache();
+    }
+
+    int minX = std::max(startX, 0);
+    int minZ = std::max(startZ, 0);
+    int maxX = std::min(startX + columns, m_width) - 1;
+    int maxZ = std::min(startZ + rows, m_width) - 1;
+
+    if (minX > maxX || minZ > maxZ)
+    {
+        return; //Entirely off the map
+    }
+
+    for (int z = minZ; z <= maxZ; ++z)
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            m_heights[(z * m_width) + x] += offsets[((z - startZ) * columns) + (x - startX)];
+        }
+    }
+
+    m_quadtree->updateRegion(minX, minZ, maxX, maxZ);
+
+    //The normals around the edge of the block lean towards it, so they change too
+    int shadeMinX = std::max(minX - 1, 0);
+    int shadeMinZ = std::max(minZ - 1, 0);
+    int shadeMaxX = std::min(maxX + 1, m_width - 1);
+    int shadeMaxZ = std::min(maxZ + 1, m_width - 1);
+    if (!m_isDisplaced)
+    {
+        updateShading(shadeMinX, shadeMinZ, shadeMaxX, shadeMaxZ);
+    }
+
+    //A grid position on the edge between two chunks belongs to both
+    const int chunksPerSide = (m_width - 1) / CHUNK_SIZE;
+    int firstChunkX = std::max((shadeMinX - 1) / CHUNK_SIZE, 0);
+    int firstChunkZ = std::max((shadeMinZ - 1) / CHUNK_SIZE, 0);
+    int lastChunkX = std::min(shadeMaxX / CHUNK_SIZE, chunksPerSide - 1);
+    int lastChunkZ = std::min(shadeMaxZ / CHUNK_SIZE, chunksPerSide - 1);
+
+    bool requantize = false;
+    for (int chunkZ = firstChunkZ; chunkZ <= lastChunkZ; ++chunkZ)
+    {
+        for (int chunkX = firstChunkX; chunkX <= lastChunkX; ++chunkX)
+        {
+            Chunk& chunk = m_chunks[(chunkZ * chunksPerSide) + chunkX];
+
+            float lowest, highest;
+            m_quadtree->getHeightRange(chunk.startX, chunk.startZ, chunk.startX + CHUNK_SIZE,
+                                       chunk.startZ + CHUNK_SIZE, lowest, highest);
+            chunk.minBounds.y = lowest;
+            chunk.maxBounds.y = highest;
+
+            if (lowest - m_skirtDepth < m_heightQuantMin || highest > m_heightQuantMax)
+            {
+                requantize = true;
+            }
+        }
+    }
+
+    if (m_isDisplaced)
+    {
+        //The shader works out the normals itself, so only the heights that changed are sent
+        uploadHeightField(minX, minZ, maxX, maxZ);
+        return;
+    }
+
+    if (requantize)
+    {
+        //The heights have left the range the vertices can hold, so every
+        //chunk has to be built again with a new one
+        updateChunks();
+        return;
+    }
+
+    for (int chunkZ = firstChunkZ; chunkZ <= lastChunkZ; ++chunkZ)
+    {
+        for (int chunkX = firstChunkX; chunkX <= lastChunkX; ++chunkX)
+        {
+            //Chunks that aren't on the GPU are built from the new heights when they're paged in
+            const Chunk& chunk = m_chunks[(chunkZ * chunksPerSide) + chunkX];
+            if (chunk.vertexBuffer)
+            {
+                uploadChunkRegion(chunk, shadeMinX, shadeMinZ, shadeMaxX, shadeMaxZ);
+            }
+        }
+    }
+}
+
+/**
+    Lowers a bowl shaped area of the terrain around position, depth at
+    the middle and nothing at radius.
+*/
+void Terrain::addCrater(const Vector3& position, float radius, float depth)
+{
+    float halfWidth = float(m_width) * 0.5f;
+    float centerX = position.x + halfWidth;
+    float centerZ = position.z + halfWidth;
+
+    int startX = (int)floorf(centerX - radius);
+    int startZ = (int)floorf(centerZ - radius);
+    int columns = (int)ceilf(centerX + radius) - startX + 1;
+    int rows = (int)ceilf(centerZ + radius) - startZ + 1;
+
+    vector<float> offsets(columns * rows);
+    for (int z = 0; z < rows; ++z)
     {
-        (*v).y *= scale;
+        for (int x = 0; x < columns; ++x)
+        {
+            float dx = float(startX + x) - centerX;
+            float dz = float(startZ + z) - centerZ;
+            float distanceSquared = (dx * dx) + (dz * dz);
+
+            if (distanceSquared < radius * radius)
+            {
+                offsets[(z * columns) + x] = -depth * (1.0f - (distanceSquared / (radius * radius)));
+            }
+        }
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLfloat) * m_vertices.size() * 3, &m_vertices[0]);
+    deformRegion(startX, startZ, columns, rows, &offsets[0]);
 }
@@ -7,28 +7,100 @@
 
 #include <string>
 #include <vector>
+#include <list>
+#include <memory>
 #include <GL/Glew.h>
 #include "targa.h"
 #include "geom.h"
+#include "terrainvertex.h"
 
 class GLSLProgram;
+class TiledHeightmap;
+class TerrainCache;
+class HeightQuadtree;
+class JobSystem;
 
+/**
+    A heightmap terrain. The grid is split into square chunks which each
+    get their own vertex buffer, chunks outside the view are skipped and
+    the rest are drawn with less detail the further away they are
+    (geomipmapping). A skirt hangs down from the edges of every chunk to
+    hide the cracks where two levels of detail meet.
+
+    Chunks are paged onto the GPU as the camera comes near them and the
+    least recently used ones are dropped once there are too many. With a
+    tiled heightmap (see TiledHeightmap) the heights stay in the mapped
+    file too, so maps far bigger than we'd want to hold as vertex arrays
+    can be walked around.
+
+    If it's asked for (setDisplacementEnabled()), OpenGL 3 is available
+    and the heights are all in memory, the terrain is displaced on the
+    GPU instead: every chunk is drawn from the
+    same flat patch and the vertex shader looks the heights up in a float
+    texture, working out the normals from them as it goes. Nothing but the
+    heights is kept per vertex, and vertices slide (morph) into the next
+    level of detail as they get further away rather than popping.
+
+    The heightmap width must be a multiple of CHUNK_SIZE plus one.
+*/
 class Terrain
 {
 public:
     Terrain(const std::string& vertexShader, const std::string& fragmentShader, const std::string& waterVert="", const std::string& waterFrag="");
     virtual ~Terrain();
 
-    bool loadHeightmap(const std::string& rawFile, const std::string& grassTexture, const std::string& heightTexture, int width, bool generateWater=false, const std::string& waterTexture="");
+    bool loadHeightmap(const std::string& rawFile, int width, bool generateWater=false);
+    bool loadTiledHeightmap(const std::string& tiledFile, bool generateWater=false);
+    bool loadBakedHeightmap(const std::string& rawFile, float heightScale, const std::string& cacheFile,
+                            bool generateWater=false);
+    bool initializeGraphics(const std::string& grassTexture, const std::string& heightTexture, const std::string& waterTexture="");
+
+    //Must be called before initializeGraphics(), the chunks are drawn as usual if it can't be done
+    void setDisplacementEnabled(bool enabled) { m_displacementEnabled = enabled; }
     void render(float mvp[]) const;
     void renderWater(float mvp[]) const;
 
-    Vertex getPositionAt(int x, int z);
-    GLfloat getHeightAt(GLfloat x, GLfloat z);
+    Vertex getPositionAt(int x, int z) const;
+    GLfloat getHeightAt(GLfloat x, GLfloat z) const;
+    void getHeightsAt(const float* xs, const float* zs, float* heights, int count) const;
+
+    //Grid positions run from 0 to getWidth() - 1 along each side
+    int getWidth() const { return m_width; }
+    float getGridHeight(int x, int z) const;
+
+    /**
+        Ground queries answered by a min/max quadtree (see HeightQuadtree).
+        The ray's direction doesn't need to be normalized, maxDistance is
+        in multiples of it. A segment is hit if the ground crosses it
+        anywhere between start and end.
+    */
+    bool raycast(const Vector3& origin, const Vector3& direction, float maxDistance, Vector3& hit) const;
+    bool segmentIntersect(const Vector3& start, const Vector3& end, Vector3& hit) const;
+
+    /**
+        Moves a sphere from start to end and finds how far along (0 to 1)
+        it first touches the ground. Like the terrain collider, a sphere
+        touches when its centre is less than radius above the ground.
+    */
+    bool sweepSphere(const Vector3& start, const Vector3& end, float radius, float& timeOfImpact) const;
+    void getHeightRange(float minX, float minZ, float maxX, float maxZ, float& lowest, float& highest) const;
 
     void normalizeTerrain();
     void scaleHeights(float scale);
+
+    /**
+        Adds offsets (row by row) to a block of heights starting at grid
+        position startX, startZ. Only the shading, bounds and vertex data
+        around the block are worked out again and sent to OpenGL, so the
+        cost depends on the size of the block rather than the map.
+        A tiled terrain's heights are read only.
+    */
+    void deformRegion(int startX, int startZ, int columns, int rows, const float* offsets);
+    void addCrater(const Vector3& position, float radius, float depth);
     void SetMVP(float* mvp);
+
+    //Used to spread the work of building the terrain over several threads
+    void setJobSystem(JobSystem* jobs) { m_jobs = jobs; }
     
     
     float getMinX() { return m_minX; }
@@ -36,33 +108,120 @@ public:
     float getMinZ() { return m_minZ; }
     float getMaxZ() { return m_maxZ; }
 private:
-    void generateVertices(const std::vector<float> heights, int width);
-    void generateIndices(int width);
+    void storeHeights(const std::vector<float>& heights, int width);
     void generateTexCoords(int width);
     void generateNormals();
+    void updateNormals(int minX, int minZ, int maxX, int maxZ);
+    void generateNormalRow(int z, int minX, int maxX);
+    void updateShading(int minX, int minZ, int maxX, int maxZ);
+    void unbakeCache();
 
     void generateWaterVertices(int width);
     void generateWaterIndices(int width);
     void generateWaterTexCoords(int width);
 
-    GLuint m_vertexBuffer;
-    GLuint m_indexBuffer;
-    GLuint m_colorBuffer;
-    GLuint m_texCoordBuffer;
-    GLuint m_heightTexCoordBuffer;
+    /**
+        Every chunk numbers its vertices the same way, the grid row by row
+        followed by the four skirts, so they all share one index buffer
+        for each level of detail.
+    */
+    struct Chunk
+    {
+        int startX; //Grid position of the chunk's first vertex
+        int startZ;
+        Vertex minBounds;
+        Vertex maxBounds;
+        GLuint vertexBuffer; //0 until the chunk is paged in
+        std::list<int>::iterator residentPosition;
+    };
+
+    static const int CHUNK_SIZE = 32; //Quads along each side of a chunk, must be a power of two
+
+    const float* getHeightData() const;
+    void getGridVertex(int x, int z, float drop, TerrainVertex& vertex) const;
+
+    /**
+        A vertex of the flat patch every chunk is drawn from when the
+        terrain is displaced on the GPU. It's in the same order as a
+        chunk's vertices so the index buffers work for both.
+    */
+    struct PatchVertex
+    {
+        GLubyte x, z; //Grid steps from the chunk's corner
+        GLubyte skirt; //1 to hang the vertex down to the bottom of the skirt
+        GLubyte padding;
+    };
 
-    GLuint m_normalBuffer;
+    void generateChunks();
+    void generateChunkIndices();
+    void buildChunkVertex(const Chunk& chunk, int x, int z, float drop, TerrainVertex& vertex) const;
+    void buildChunkVertices(const Chunk& chunk, std::vector<TerrainVertex>& vertices) const;
+    void buildLevelIndices(int level, std::vector<GLushort>& indices) const;
+    bool bakeCache(const std::string& cacheFile, unsigned long long hash) const;
+    void updateChunkBounds();
+    void uploadChunk(Chunk& chunk) const;
+    void uploadChunkRegion(const Chunk& chunk, int minX, int minZ, int maxX, int maxZ) const;
+    void updateChunks();
+    bool isDisplacementSupported() const;
+    void initializeDisplacement();
+    void uploadHeightField(int minX, int minZ, int maxX, int maxZ) const;
+    void updateResidentChunks(const Vertex& eye) const;
+    void evictChunk(int index) const;
+    float getChunkDistance(const Chunk& chunk, const Vertex& eye) const;
+    int getChunkLevel(const Chunk& chunk, const Vertex& eye) const;
+
+    static const int QUADTREE_LEAF_SIZE = 8; //Cells along each side of a quadtree leaf
+
+    void updateQuadtree();
+
+    //Chunks are paged in and out while drawing
+    mutable std::vector<Chunk> m_chunks;
+    mutable std::list<int> m_residentChunks; //Most recently used first
+
+    //Only set when the heights are streamed from a tiled heightmap
+    std::auto_ptr<TiledHeightmap> m_tiles;
+    float m_heightScale;
+
+    //Only set when the terrain was loaded from a baked cache
+    std::auto_ptr<TerrainCache> m_cache;
+
+    std::auto_ptr<HeightQuadtree> m_quadtree;
+
+    static const unsigned int NORMAL_ROWS_PER_JOB = 16;
+    JobSystem* m_jobs;
+    std::vector<GLuint> m_levelIndexBuffers;
+    std::vector<GLsizei> m_levelIndexCounts;
+    bool m_usePrimitiveRestart; //Without it (before GL 3.1) the strips are joined with degenerate triangles
+    int m_levelCount;
+    float m_skirtDepth;
+
+    //Vertex heights are stored as m_heightQuantMin + (y * m_heightQuantStep)
+    float m_heightQuantMin;
+    float m_heightQuantMax;
+    float m_heightQuantStep;
+
+    //The normals and height texture coordinates were made from the heights
+    //before they were normalized and scaled, these take the current heights
+    //back to what they were made from
+    float m_normalScale;
+    float m_heightTexScale;
+    float m_heightTexOffset;
+
+    //Only used when the terrain is displaced on the GPU
+    bool m_displacementEnabled;
+    bool m_isDisplaced;
+    GLuint m_heightFieldTexID;
+    GLuint m_patchVertexBuffer;
 
     GLuint m_waterVertexBuffer;
     GLuint m_waterIndexBuffer;
     GLuint m_waterTexCoordsBuffer;
 
-    std::vector<Vertex> m_vertices;
+    std::vector<float> m_heights; //Row by row, unused when the heights are mapped
     std::vector<Color> m_colors;
     std::vector<TexCoord> m_texCoords;
     std::vector<float> m_heightTexCoords;
 
-    std::vector<GLuint> m_indices;
     std::vector<Vertex> m_normals;
 
     std::vector<Vertex> m_waterVertices;
@@ -83,6 +242,11 @@ private:
     GLSLProgram* m_shaderProgram;
     GLSLProgram* m_waterShaderProgram;
 
+    std::string m_vertexShader;
+    std::string m_fragmentShader;
+    std::string m_waterVertexShader;
+    std::string m_waterFragmentShader;
+
     float m_minX;
     float m_maxX;
     float m_minZ;
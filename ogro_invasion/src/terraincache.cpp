@@ -0,0 +1,155 @@
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+#include "terraincache.h"
+
+using std::vector;
+using std::string;
+
+const char TERRAIN_CACHE_MAGIC[4] = { 'O', 'T', 'B', 'C' };
+const unsigned int TERRAIN_CACHE_VERSION = 4; //Bump whenever the vertex layout or the way terrain is built changes
+
+TerrainCache::TerrainCache():
+m_header(NULL),
+m_chunkBounds(NULL),
+m_levels(NULL),
+m_heights(NULL),
+m_vertices(NULL),
+m_indices(NULL)
+{
+}
+
+bool TerrainCache::open(const string& filename, unsigned long long hash)
+{
+    m_header = NULL;
+
+    std::ifstream exists(filename.c_str());
+    if (!exists.good())
+    {
+        return false; //Not baked yet, no need to complain
+    }
+    exists.close();
+
+    if (!m_file.open(filename) || m_file.getSize() < sizeof(Header))
+    {
+        return false;
+    }
+
+    const Header* header = (const Header*)m_file.getData();
+    if (memcmp(header->magic, TERRAIN_CACHE_MAGIC, sizeof(TERRAIN_CACHE_MAGIC)) != 0 ||
+        header->version != TERRAIN_CACHE_VERSION || header->hash != hash)
+    {
+        std::cout << filename << " is out of date, the terrain will be rebuilt" << std::endl;
+        m_file.close();
+        return false;
+    }
+
+    const size_t boundsOffset = sizeof(Header);
+    const size_t levelsOffset = boundsOffset + (sizeof(ChunkBounds) * header->chunkCount);
+    const size_t heightsOffset = levelsOffset + (sizeof(Level) * header->levelCount);
+    const size_t verticesOffset = heightsOffset + (sizeof(float) * header->width * header->width);
+    const size_t indicesOffset = verticesOffset + (sizeof(TerrainVertex) * header->chunkCount * header->chunkVertexCount);
+
+    //The level table says how many indices there are, so check we can read it first
+    size_t indexCount = 0;
+    if (heightsOffset <= m_file.getSize() && header->levelCount > 0)
+    {
+        const Level& last = ((const Level*)(m_file.getData() + levelsOffset))[header->levelCount - 1];
+        indexCount = last.offset + last.count;
+    }
+
+    if (header->levelCount == 0 || indicesOffset + (sizeof(unsigned short) * indexCount) != m_file.getSize())
+    {
+        std::cout << filename << " is the wrong size, the terrain will be rebuilt" << std::endl;
+        m_file.close();
+        return false;
+    }
+
+    m_header = header;
+    m_chunkBounds = (const ChunkBounds*)(m_file.getData() + boundsOffset);
+    m_levels = (const Level*)(m_file.getData() + levelsOffset);
+    m_heights = (const float*)(m_file.getData() + heightsOffset);
+    m_vertices = (const TerrainVertex*)(m_file.getData() + verticesOffset);
+    m_indices = (const unsigned short*)(m_file.getData() + indicesOffset);
+
+    return true;
+}
+
+const TerrainVertex* TerrainCache::getChunkVertices(int chunk) const
+{
+    return m_vertices + (chunk * m_header->chunkVertexCount);
+}
+
+const unsigned short* TerrainCache::getLevelIndices(int level) const
+{
+    return m_indices + m_levels[level].offset;
+}
+
+bool TerrainCache::write(const string& filename, unsigned long long hash, int width, int chunkSize,
+                         float normalScale, float heightTexScale, float heightTexOffset,
+                         const vector<float>& heights, const vector<float>& chunkMinHeights,
+                         const vector<float>& chunkMaxHeights, const vector<TerrainVertex>& vertices,
+                         const vector<vector<unsigned short> >& levelIndices)
+{
+    Header header;
+    memcpy(header.magic, TERRAIN_CACHE_MAGIC, sizeof(TERRAIN_CACHE_MAGIC));
+    header.version = TERRAIN_CACHE_VERSION;
+    header.hash = hash;
+    header.width = width;
+    header.chunkSize = chunkSize;
+    header.chunkCount = chunkMinHeights.size();
+    header.chunkVertexCount = vertices.size() / chunkMinHeights.size();
+    header.levelCount = levelIndices.size();
+    header.normalScale = normalScale;
+    header.heightTexScale = heightTexScale;
+    header.heightTexOffset = heightTexOffset;
+    header.reserved = 0;
+
+    vector<ChunkBounds> bounds(header.chunkCount);
+    for (unsigned int i = 0; i < header.chunkCount; ++i)
+    {
+        bounds[i].minHeight = chunkMinHeights[i];
+        bounds[i].maxHeight = chunkMaxHeights[i];
+    }
+
+    vector<Level> levels(header.levelCount);
+    unsigned int offset = 0;
+    for (unsigned int i = 0; i < header.levelCount; ++i)
+    {
+        levels[i].offset = offset;
+        levels[i].count = levelIndices[i].size();
+        offset += levels[i].count;
+    }
+
+    std::ofstream fileOut(filename.c_str(), std::ios::binary);
+    if (!fileOut.good())
+    {
+        std::cerr << "Could not open " << filename << " for writing" << std::endl;
+        return false;
+    }
+
+    fileOut.write((const char*)&header, sizeof(Header));
+    fileOut.write((const char*)&bounds[0], sizeof(ChunkBounds) * bounds.size());
+    fileOut.write((const char*)&levels[0], sizeof(Level) * levels.size());
+    fileOut.write((const char*)&heights[0], sizeof(float) * heights.size());
+    fileOut.write((const char*)&vertices[0], sizeof(TerrainVertex) * vertices.size());
+
+    for (vector<vector<unsigned short> >::const_iterator level = levelIndices.begin(); level != levelIndices.end(); ++level)
+    {
+        fileOut.write((const char*)&(*level)[0], sizeof(unsigned short) * (*level).size());
+    }
+
+    return fileOut.good();
+}
+
+unsigned long long TerrainCache::hash(const void* data, size_t size, unsigned long long hash)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,98 @@
+#ifndef TERRAINCACHE_H_INCLUDED
+#define TERRAINCACHE_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "uncopyable.h"
+#include "mappedfile.h"
+#include "terrainvertex.h"
+
+/**
+    The terrain exactly as it's sent to OpenGL, saved after it has been
+    built once so later runs can skip generating it. The file holds the
+    final heights, every chunk's vertices (skirts and all), the index
+    data for each level of detail and each chunk's height range.
+
+    The cache is memory mapped, chunks are uploaded straight from it. It
+    is only used if it was made from the same heightmap and settings,
+    which is checked with a hash of both.
+*/
+class TerrainCache : private Uncopyable
+{
+public:
+    TerrainCache();
+
+    bool open(const std::string& filename, unsigned long long hash);
+
+    int getWidth() const { return (int)m_header->width; }
+    int getChunkSize() const { return (int)m_header->chunkSize; }
+    int getChunkCount() const { return (int)m_header->chunkCount; }
+    int getChunkVertexCount() const { return (int)m_header->chunkVertexCount; }
+    int getLevelCount() const { return (int)m_header->levelCount; }
+
+    //How the shading was worked out from the heights, see Terrain::deformRegion()
+    float getNormalScale() const { return m_header->normalScale; }
+    float getHeightTexScale() const { return m_header->heightTexScale; }
+    float getHeightTexOffset() const { return m_header->heightTexOffset; }
+
+    //The heights of every grid position, row by row
+    const float* getHeights() const { return m_heights; }
+
+    float getChunkMinHeight(int chunk) const { return m_chunkBounds[chunk].minHeight; }
+    float getChunkMaxHeight(int chunk) const { return m_chunkBounds[chunk].maxHeight; }
+    const TerrainVertex* getChunkVertices(int chunk) const;
+
+    const unsigned short* getLevelIndices(int level) const;
+    unsigned int getLevelIndexCount(int level) const { return m_levels[level].count; }
+
+    static bool write(const std::string& filename, unsigned long long hash, int width, int chunkSize,
+                      float normalScale, float heightTexScale, float heightTexOffset,
+                      const std::vector<float>& heights, const std::vector<float>& chunkMinHeights,
+                      const std::vector<float>& chunkMaxHeights, const std::vector<TerrainVertex>& vertices,
+                      const std::vector<std::vector<unsigned short> >& levelIndices);
+
+    //64-bit FNV-1a, pass the last result back in to hash more data
+    static unsigned long long hash(const void* data, size_t size,
+                                   unsigned long long hash = 14695981039346656037ULL);
+
+private:
+    struct Header
+    {
+        char magic[4];
+        unsigned int version;
+        unsigned long long hash;
+        unsigned int width;
+        unsigned int chunkSize;
+        unsigned int chunkCount;
+        unsigned int chunkVertexCount;
+        unsigned int levelCount;
+        float normalScale;
+        float heightTexScale;
+        float heightTexOffset;
+        unsigned int reserved;
+    };
+
+    struct ChunkBounds
+    {
+        float minHeight;
+        float maxHeight;
+    };
+
+    struct Level
+    {
+        unsigned int offset; //In indices from the start of the index data
+        unsigned int count;
+    };
+
+    MappedFile m_file;
+    const Header* m_header;
+    const ChunkBounds* m_chunkBounds;
+    const Level* m_levels;
+    const float* m_heights;
+    const TerrainVertex* m_vertices;
+    const unsigned short* m_indices;
+};
+
+#endif // TERRAINCACHE_H_INCLUDED
@@ -5,6 +5,11 @@
 #include "terraincollider.h"
 #include "terrain.h"
 #include "entity.h"
+#include "collisiongrid.h"
+
+using std::vector;
+
+static const unsigned int NOT_BATCHED = ~0u;
 
 TerrainCollider::TerrainCollider(Entity* entity, Terrain* terrain):
 Collider(entity),
@@ -13,7 +18,72 @@ m_terrain(terrain)
 
 }
 
-bool TerrainCollider::collideWith(const Collider* collider)
+void TerrainCollider::prepareCollisions(const CollisionGrid& grid)
+{
+    const vector<Collider*>& colliders = grid.getBoundedColliders();
+
+    //Only what the terrain will be paired with (not the trees)
+    m_batchColliders.clear();
+    m_batchX.clear();
+    m_batchZ.clear();
+    m_batchIndices.assign(m_batchIndices.size(), NOT_BATCHED);
+
+    for (unsigned int i = 0; i < colliders.size(); ++i)
+    {
+        if (!canCollideWith(colliders[i]))
+        {
+            continue;
+        }
+
+        const Entity* entity = colliders[i]->getEntity();
+        if (entity->getStoreSlot() >= m_batchIndices.size())
+        {
+            m_batchIndices.resize(entity->getStoreSlot() + 1, NOT_BATCHED);
+        }
+        m_batchIndices[entity->getStoreSlot()] = m_batchColliders.size();
+
+        Vector3 position = entity->getPosition();
+        m_batchColliders.push_back(colliders[i]);
+        m_batchX.push_back(position.x);
+        m_batchZ.push_back(position.z);
+    }
+
+    m_batchHeights.resize(m_batchColliders.size());
+    if (!m_batchColliders.empty())
+    {
+        m_terrain->getHeightsAt(&m_batchX[0], &m_batchZ[0], &m_batchHeights[0], (int)m_batchColliders.size());
+    }
+}
+
+float TerrainCollider::getGroundHeight(const Collider* collider)
+{
+    const Entity* entity = collider->getEntity();
+    Vector3 position = entity->getPosition();
+
+    /*
+        Asked for both while the pairs are tested and again when the
+        contacts are handed out afterwards (the landscape pushing the
+        entity back up), so it's found by its store slot rather than the
+        order the pairs come in. Nothing is added to or taken out of the
+        store during the collision pass, so the slots still match the
+        batch.
+    */
+    const unsigned int slot = entity->getStoreSlot();
+    if (slot < m_batchIndices.size() && m_batchIndices[slot] != NOT_BATCHED)
+    {
+        const unsigned int i = m_batchIndices[slot];
+
+        //It might have been moved by an earlier collision this frame
+        if (m_batchColliders[i] == collider && m_batchX[i] == position.x && m_batchZ[i] == position.z)
+        {
+            return m_batchHeights[i];
+        }
+    }
+
+    return m_terrain->getHeightAt(position.x, position.z);
+}
+
+bool TerrainCollider::collideWith(const Collider* collider, float& timeOfImpact)
 {
     /*
         If the collider is below the terrain we class it as a
@@ -23,15 +93,29 @@ bool TerrainCollider::collideWith(const Collider* collider)
 
 
     Vector3 position = collider->getEntity()->getPosition();
-    float height = m_terrain->getHeightAt(position.x, position.z);
+    float height = getGroundHeight(collider);
     float radius = collider->getRadius();
 
     if (position.y < (height + radius)) {
     //    position.y = (height + radius);
         //Move the entity up level with the terrain
       //  collider->getEntity()->setPosition(position);
+        timeOfImpact = 1.0f;
+
+        //Find where it went in on the way down
+        if (collider->isContinuous())
+        {
+            m_terrain->sweepSphere(collider->getEntity()->getPreviousPosition(), position, radius, timeOfImpact);
+        }
         return true;
     }
 
+    //It's above the ground now, but a fast entity may have gone through a
+    //ridge on the way here
+    if (collider->isContinuous())
+    {
+        return m_terrain->sweepSphere(collider->getEntity()->getPreviousPosition(), position, radius, timeOfImpact);
+    }
+
     return false;
 }
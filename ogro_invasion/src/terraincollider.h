@@ -1,20 +1,37 @@
 #ifndef TERRAINCOLLIDER_H_INCLUDED
 #define TERRAINCOLLIDER_H_INCLUDED
 
+#include <vector>
 #include "collider.h"
 
 class Terrain;
 
 class TerrainCollider : public Collider {
 private:
-    bool collideWith(const Collider* collider);
+    bool collideWith(const Collider* collider, float& timeOfImpact);
+    void prepareCollisions(const CollisionGrid& grid);
 
     Terrain* m_terrain;
+
+    //The ground height under every collider in the grid, looked up in one
+    //batch each frame rather than one at a time as the pairs are tested
+    std::vector<const Collider*> m_batchColliders;
+    std::vector<float> m_batchX;
+    std::vector<float> m_batchZ;
+    std::vector<float> m_batchHeights;
+
+    //Where each entity's height is in the batch, by its store slot (NOT_BATCHED if it isn't)
+    std::vector<unsigned int> m_batchIndices;
 public:
     TerrainCollider(Entity* entity, Terrain* terrain);
 
     float getRadius() const { return 0.0f; } //The terrain doesn't collide with other entities in the same way
     void setRadius(const float radius) { }
+
+    //The terrain covers the whole map so it can't be put in a grid cell
+    bool isBounded() const { return false; }
+
+    float getGroundHeight(const Collider* collider);
 };
 
 #endif // TERRAINCOLLIDER_H_INCLUDED
@@ -0,0 +1,23 @@
+#ifndef TERRAINVERTEX_H_INCLUDED
+#define TERRAINVERTEX_H_INCLUDED
+
+/**
+    One vertex of a terrain chunk, everything the terrain shader needs
+    side by side so a vertex is fetched in one go. It's all packed into
+    16-bit integers (16 bytes rather than 36 as floats):
+
+    - x and z count grid steps from the chunk's corner, y is quantized
+      over the terrain's height range. The shader scales and offsets
+      them back into place.
+    - height, s and t are normalized, the shader scales the texcoords up.
+    - The normal is octahedral encoded, only its x and z are stored.
+*/
+struct TerrainVertex
+{
+    unsigned short x, y, z;
+    unsigned short height; //Coordinate into the height colour texture
+    unsigned short s, t;
+    short normalX, normalZ;
+};
+
+#endif // TERRAINVERTEX_H_INCLUDED
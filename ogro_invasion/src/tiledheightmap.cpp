@@ -0,0 +1,174 @@
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+#include "tiledheightmap.h"
+
+using std::vector;
+using std::string;
+
+const char TILED_HEIGHTMAP_MAGIC[4] = { 'O', 'T', 'H', 'M' };
+const unsigned int TILED_HEIGHTMAP_VERSION = 1;
+
+TiledHeightmap::TiledHeightmap():
+m_header(NULL),
+m_tileBounds(NULL),
+m_heights(NULL),
+m_tilesPerSide(0),
+m_tileVertexCount(0)
+{
+}
+
+bool TiledHeightmap::open(const string& filename)
+{
+    m_header = NULL;
+
+    if (!m_file.open(filename))
+    {
+        return false;
+    }
+
+    if (m_file.getSize() < sizeof(Header))
+    {
+        std::cerr << filename << " is too small to be a tiled heightmap" << std::endl;
+        return false;
+    }
+
+    const Header* header = (const Header*)m_file.getData();
+    if (memcmp(header->magic, TILED_HEIGHTMAP_MAGIC, sizeof(TILED_HEIGHTMAP_MAGIC)) != 0 ||
+        header->version != TILED_HEIGHTMAP_VERSION)
+    {
+        std::cerr << filename << " is not a tiled heightmap this version can read" << std::endl;
+        return false;
+    }
+
+    if (header->tileSize == 0 || header->width <= header->tileSize ||
+        (header->width - 1) % header->tileSize != 0)
+    {
+        std::cerr << filename << " has a bad tile size" << std::endl;
+        return false;
+    }
+
+    m_tilesPerSide = (header->width - 1) / header->tileSize;
+    m_tileVertexCount = (header->tileSize + 1) * (header->tileSize + 1);
+
+    const size_t tileCount = m_tilesPerSide * m_tilesPerSide;
+    const size_t expectedSize = sizeof(Header) + (sizeof(TileBounds) * tileCount) +
+                                (sizeof(unsigned short) * m_tileVertexCount * tileCount);
+    if (m_file.getSize() != expectedSize)
+    {
+        std::cerr << filename << " is the wrong size, it may be truncated" << std::endl;
+        return false;
+    }
+
+    m_header = header;
+    m_tileBounds = (const TileBounds*)(m_file.getData() + sizeof(Header));
+    m_heights = (const unsigned short*)(m_file.getData() + sizeof(Header) + (sizeof(TileBounds) * tileCount));
+
+    return true;
+}
+
+float TiledHeightmap::getTileMinHeight(int tileX, int tileZ) const
+{
+    return m_tileBounds[(tileZ * m_tilesPerSide) + tileX].minHeight;
+}
+
+float TiledHeightmap::getTileMaxHeight(int tileX, int tileZ) const
+{
+    return m_tileBounds[(tileZ * m_tilesPerSide) + tileX].maxHeight;
+}
+
+float TiledHeightmap::getHeight(int x, int z) const
+{
+    const int width = (int)m_header->width;
+    const int tileSize = (int)m_header->tileSize;
+
+    if (x < 0) x = 0;
+    if (z < 0) z = 0;
+    if (x >= width) x = width - 1;
+    if (z >= width) z = width - 1;
+
+    //The last row and column belong to the tiles before them
+    int tileX = x / tileSize;
+    int tileZ = z / tileSize;
+    if (tileX >= m_tilesPerSide) tileX = m_tilesPerSide - 1;
+    if (tileZ >= m_tilesPerSide) tileZ = m_tilesPerSide - 1;
+
+    const unsigned short* tile = m_heights + ((tileZ * m_tilesPerSide) + tileX) * m_tileVertexCount;
+    int localX = x - (tileX * tileSize);
+    int localZ = z - (tileZ * tileSize);
+
+    return (float)tile[(localZ * (tileSize + 1)) + localX] * m_header->heightScale;
+}
+
+bool TiledHeightmap::write(const string& filename, const vector<unsigned short>& heights,
+                           int width, int tileSize, float heightScale)
+{
+    if (tileSize <= 0 || width <= tileSize || (width - 1) % tileSize != 0 ||
+        (int)heights.size() != width * width)
+    {
+        std::cerr << "Can't tile a " << width << " wide heightmap into tiles of " << tileSize << std::endl;
+        return false;
+    }
+
+    const int tilesPerSide = (width - 1) / tileSize;
+    const int side = tileSize + 1;
+
+    vector<TileBounds> bounds;
+    vector<unsigned short> tiles;
+    tiles.reserve(tilesPerSide * tilesPerSide * side * side);
+
+    for (int tileZ = 0; tileZ < tilesPerSide; ++tileZ)
+    {
+        for (int tileX = 0; tileX < tilesPerSide; ++tileX)
+        {
+            unsigned short lowest = 0xFFFF;
+            unsigned short highest = 0;
+
+            for (int z = 0; z < side; ++z)
+            {
+                for (int x = 0; x < side; ++x)
+                {
+                    unsigned short height = heights[((tileZ * tileSize + z) * width) + (tileX * tileSize) + x];
+                    if (height < lowest) lowest = height;
+                    if (height > highest) highest = height;
+                    tiles.push_back(height);
+                }
+            }
+
+            TileBounds tileBounds;
+            tileBounds.minHeight = lowest * heightScale;
+            tileBounds.maxHeight = highest * heightScale;
+            bounds.push_back(tileBounds);
+        }
+    }
+
+    Header header;
+    memcpy(header.magic, TILED_HEIGHTMAP_MAGIC, sizeof(TILED_HEIGHTMAP_MAGIC));
+    header.version = TILED_HEIGHTMAP_VERSION;
+    header.width = width;
+    header.tileSize = tileSize;
+    header.heightScale = heightScale;
+    header.minHeight = bounds[0].minHeight;
+    header.maxHeight = bounds[0].maxHeight;
+    header.reserved = 0;
+
+    for (vector<TileBounds>::const_iterator it = bounds.begin(); it != bounds.end(); ++it)
+    {
+        if ((*it).minHeight < header.minHeight) header.minHeight = (*it).minHeight;
+        if ((*it).maxHeight > header.maxHeight) header.maxHeight = (*it).maxHeight;
+    }
+
+    std::ofstream fileOut(filename.c_str(), std::ios::binary);
+    if (!fileOut.good())
+    {
+        std::cerr << "Could not open " << filename << " for writing" << std::endl;
+        return false;
+    }
+
+    fileOut.write((const char*)&header, sizeof(Header));
+    fileOut.write((const char*)&bounds[0], sizeof(TileBounds) * bounds.size());
+    fileOut.write((const char*)&tiles[0], sizeof(unsigned short) * tiles.size());
+
+    return fileOut.good();
+}
@@ -0,0 +1,78 @@
+#ifndef TILEDHEIGHTMAP_H_INCLUDED
+#define TILEDHEIGHTMAP_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+#include "uncopyable.h"
+#include "mappedfile.h"
+
+/**
+    A heightmap stored as square tiles of 16-bit heights, one after
+    another, so everything needed to build a terrain chunk sits together
+    in the file. Neighbouring tiles both store the row of heights along
+    their shared edge.
+
+    The file is memory mapped rather than read, only the tiles that are
+    used get paged in. A table of each tile's lowest and highest point
+    follows the header so chunks can be culled before their heights are
+    ever touched.
+
+    The heights returned are the stored values multiplied by the file's
+    height scale.
+*/
+class TiledHeightmap : private Uncopyable
+{
+public:
+    TiledHeightmap();
+
+    bool open(const std::string& filename);
+
+    int getWidth() const { return m_header ? (int)m_header->width : 0; }
+    int getTileSize() const { return m_header ? (int)m_header->tileSize : 0; }
+    int getTilesPerSide() const { return m_tilesPerSide; }
+
+    float getMinHeight() const { return m_header->minHeight; }
+    float getMaxHeight() const { return m_header->maxHeight; }
+
+    float getTileMinHeight(int tileX, int tileZ) const;
+    float getTileMaxHeight(int tileX, int tileZ) const;
+
+    //x and z are grid positions, anything off the map is clamped to the edge
+    float getHeight(int x, int z) const;
+
+    /**
+        Cuts width * width heights into tiles of tileSize quads and saves
+        them. (width - 1) must be a multiple of tileSize.
+    */
+    static bool write(const std::string& filename, const std::vector<unsigned short>& heights,
+                      int width, int tileSize, float heightScale);
+
+private:
+    struct Header
+    {
+        char magic[4];
+        unsigned int version;
+        unsigned int width;
+        unsigned int tileSize;
+        float heightScale;
+        float minHeight;
+        float maxHeight;
+        unsigned int reserved;
+    };
+
+    struct TileBounds
+    {
+        float minHeight;
+        float maxHeight;
+    };
+
+    MappedFile m_file;
+    const Header* m_header;
+    const TileBounds* m_tileBounds;
+    const unsigned short* m_heights;
+    int m_tilesPerSide;
+    int m_tileVertexCount;
+};
+
+#endif // TILEDHEIGHTMAP_H_INCLUDED
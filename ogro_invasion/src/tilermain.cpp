@@ -0,0 +1,98 @@
+/**
+    Converts a .raw heightmap into a tiled heightmap that the terrain can
+    stream from (see TiledHeightmap). The raw file can hold 8 or 16-bit
+    (little endian) heights, which is worked out from its size.
+
+    Usage: ogro_tiler <input.raw> <output.tiles> [--height <world units>]
+*/
+
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+
+#include "tiledheightmap.h"
+
+using std::vector;
+using std::string;
+
+const int TILE_SIZE = 32; //Must match Terrain::CHUNK_SIZE, the terrain won't load anything else
+const float DEFAULT_HEIGHT = 10.0f; //The same scale Terrain::loadHeightmap uses
+
+int main(int argc, char** argv)
+{
+    float height = DEFAULT_HEIGHT;
+    bool badArgument = (argc < 3);
+
+    for (int i = 3; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--height" && hasValue)
+        {
+            height = (float)atof(argv[++i]);
+        }
+        else
+        {
+            badArgument = true;
+            break;
+        }
+    }
+
+    if (badArgument)
+    {
+        std::cerr << "Usage: " << argv[0] << " <input.raw> <output.tiles> [--height <world units>]" << std::endl;
+        return 1;
+    }
+
+    string inputFile = argv[1];
+    string outputFile = argv[2];
+
+    std::ifstream fileIn(inputFile.c_str(), std::ios::binary);
+    if (!fileIn.good())
+    {
+        std::cerr << "Could not open " << inputFile << std::endl;
+        return 1;
+    }
+
+    string data((std::istreambuf_iterator<char>(fileIn)), std::istreambuf_iterator<char>());
+
+    //A square number of bytes is 8-bit, twice a square number is 16-bit
+    int width = (int)(sqrtf((float)data.size()) + 0.5f);
+    bool sixteenBit = false;
+    if (width * width != (int)data.size())
+    {
+        width = (int)(sqrtf((float)data.size() / 2.0f) + 0.5f);
+        sixteenBit = true;
+
+        if (width * width * 2 != (int)data.size())
+        {
+            std::cerr << inputFile << " isn't a square heightmap" << std::endl;
+            return 1;
+        }
+    }
+
+    vector<unsigned short> heights(width * width);
+    for (int i = 0; i < width * width; ++i)
+    {
+        if (sixteenBit)
+        {
+            heights[i] = (unsigned short)((unsigned char)data[i * 2] | ((unsigned char)data[(i * 2) + 1] << 8));
+        }
+        else
+        {
+            heights[i] = (unsigned short)((unsigned char)data[i] << 8);
+        }
+    }
+
+    if (!TiledHeightmap::write(outputFile, heights, width, TILE_SIZE, height / 65536.0f))
+    {
+        return 1;
+    }
+
+    std::cout << "Wrote a " << width << "x" << width << " heightmap to " << outputFile << std::endl;
+    return 0;
+}
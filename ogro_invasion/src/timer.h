@@ -0,0 +1,44 @@
+#ifndef TIMER_H_INCLUDED
+#define TIMER_H_INCLUDED
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/**
+    A high resolution stopwatch for timing bits of the frame. It doesn't
+    need a window or GLFW so it works in the headless builds too.
+*/
+class Timer
+{
+public:
+    Timer():
+    m_start(now())
+    {
+    }
+
+    void reset() { m_start = now(); }
+    double getElapsedSeconds() const { return now() - m_start; }
+
+    //Seconds since some arbitrary point, only useful for differences
+    static double now()
+    {
+#ifdef _WIN32
+        LARGE_INTEGER frequency, counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return double(counter.QuadPart) / double(frequency.QuadPart);
+#else
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return double(time.tv_sec) + double(time.tv_nsec) * 1.0e-9;
+#endif
+    }
+
+private:
+    double m_start;
+};
+
+#endif // TIMER_H_INCLUDED
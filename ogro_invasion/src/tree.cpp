@@ -16,6 +16,7 @@
 #include "targa.h"
 #include "glslshader.h"
 #include "spherecollider.h"
+#include "gameworld.h"
 
 using std::string;
 
@@ -60,16 +61,17 @@ void Tree::onRender() const
     for (int i = 0; i < 16; ++i)
         proj[i] = mvp[i];
     
+    Vector3 position = getPosition();
     glPushMatrix();
     glm::mat4 mp = glm::make_mat4(proj);
-    glm::mat4 md =glm::translate(mp, glm::vec3(m_position.x,m_position.y,m_position.z));
+    glm::mat4 md =glm::translate(mp, glm::vec3(position.x,position.y,position.z));
     glm::mat4 modVer = md;
     
     const float *stuff = (const float*)glm::value_ptr(modVer);
     for (int i = 0; i < 16; ++i)
         model[i] = stuff[i];
     
-    glTranslatef(m_position.x, m_position.y, m_position.z);
+    glTranslatef(position.x, position.y, position.z);
 
     glGetFloatv(GL_MODELVIEW_MATRIX, modelviewMatrix);
     glGetFloatv(GL_PROJECTION_MATRIX, projectionMatrix);
@@ -144,6 +146,11 @@ void Tree::initializeVBOs()
 
 bool Tree::onInitialize()
 {
+    if (getWorld()->isHeadless())
+    {
+        return true; //Trees don't do anything but get drawn
+    }
+
     if(m_treeTexID == 0)
     {
         TargaImage treeTexture;
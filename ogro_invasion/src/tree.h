@@ -19,19 +19,12 @@ public:
     virtual bool onInitialize();
     virtual void onShutdown();
 
-    void setPosition(const Vector3& v) { m_position = v; }
-    Vector3 getPosition() const { return m_position; }
-
-    float getYaw() const { return 0.0f; }
-    float getPitch() const { return 0.0f; }
-
-    void setYaw(const float val) { }
-    void setPitch(const float val) { }
-
     Collider* getCollider() { return m_collider; }
 
     EntityType getType() const { return TREE; }
 
+    bool isStatic() const { return true; }
+
     virtual void onCollision(Entity* collider) { }
 private:
     static GLuint m_treeTexID;
@@ -41,7 +34,6 @@ private:
 
     void initializeVBOs();
 
-    Vector3 m_position;
     Collider* m_collider;
 };
 